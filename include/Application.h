@@ -5,6 +5,8 @@
 #include "GoBattleSim.h"
 
 #include <array>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace GoBattleSim
@@ -33,6 +35,10 @@ struct PvESimInput
     unsigned num_sims{0};
     AggregationMode aggregation{AggregationMode::None};
     bool enable_log{false};
+    // negative means not seeded
+    int64_t seed{-1};
+    // Chrome trace of the run, none if empty
+    std::string trace_file;
 };
 
 struct AveragePokemonState
@@ -68,6 +74,10 @@ struct PvPSimpleSimInput
     int num_sims{0};
     AggregationMode aggregation;
     bool enable_log{false};
+    // negative means not seeded
+    int64_t seed{-1};
+    // Chrome trace of the run, none if empty
+    std::string trace_file;
 };
 
 struct BattleMatrixSimInput
@@ -75,6 +85,27 @@ struct BattleMatrixSimInput
     std::vector<PvPPokemon> row_pokemon;
     std::vector<PvPPokemon> col_pokemon;
     bool averge_by_shield{false};
+    std::string output_file;
+    MatrixFileFormat output_format{MatrixFileFormat::None};
+    // only compute the tile [row_first, row_last) x [col_first, col_last); last = 0 means to the end
+    unsigned row_first{0};
+    unsigned row_last{0};
+    unsigned col_first{0};
+    unsigned col_last{0};
+    bool team_search{false};
+    TeamSearchOptions team_search_options;
+    // negative means not seeded
+    int64_t seed{-1};
+    // Chrome trace of the run, none if empty
+    std::string trace_file;
+};
+
+struct BattleMatrixFileOutput
+{
+    std::string path;
+    MatrixFileFormat format{MatrixFileFormat::None};
+    unsigned num_rows{0};
+    unsigned num_cols{0};
 };
 
 class GoBattleSimApp
@@ -106,6 +137,32 @@ public:
     void collect(SimplePvPBattleOutcome &);              // average
 
     void collect(Matrix_t &);
+    void collect(BattleMatrixFileOutput &); // streamed to file
+    void collect(std::vector<TeamScore> &);   // team search
+
+    /**
+     * progress of the current or latest run, in sims (PvE, PvP) or cells (battle matrix).
+     * Safe to call from another thread while run() is going.
+     */
+    void progress(uint64_t &num_done, uint64_t &num_total) const;
+
+    /**
+     * stop the current or next run() as soon as the running sim or cell is done.
+     * Output finished so far is still collectable. prepare() clears this.
+     * Safe to call from another thread.
+     */
+    void cancel();
+
+    /**
+     * what the battles of the latest run did. Only counted when built with GBS_PERF_COUNTERS.
+     */
+    const PerfCounters &perf() const;
+
+    /**
+     * the trace of the current input, enabled if it has a trace file.
+     * run() records into it and writes it out at the end.
+     */
+    TraceWriter &trace();
 
     /**
      * control which type of battle to run.
@@ -117,13 +174,30 @@ public:
      */
     AggregationMode aggregation_mode;
 
+    /**
+     * where the battle matrix goes. None means it is kept in memory.
+     */
+    MatrixFileFormat matrix_file_format{MatrixFileFormat::None};
+
+    /**
+     * whether to search the best teams after computing the battle matrix.
+     */
+    bool team_search{false};
+
 private:
     static GoBattleSimApp instance;
 
-    static void add_to(PvEAverageBattleOutcome &, PvEBattleOutcome);
+    static void add_to(PvEAverageBattleOutcome &, const PvEBattleOutcome &);
     static void div_by(PvEAverageBattleOutcome &, unsigned);
 
+    void write_trace();
+
     unsigned m_num_sims{0};
+    int64_t m_seed{-1};
+    RunProgress m_progress;
+    PerfCounters m_perf;
+    TraceWriter m_trace;
+    std::string m_trace_file;
 
     Battle m_pve_battle;
     std::vector<PvEBattleOutcome> m_pve_output;
@@ -134,6 +208,9 @@ private:
 
     BattleMatrix m_battle_matrix;
     BattleMatrixSimInput m_matrix_input;
+    std::unique_ptr<MatrixWriter> m_matrix_writer;
+    TeamSearchOptions m_team_search_options;
+    std::vector<TeamScore> m_teams;
 };
 } // namespace GoBattleSim
 
@@ -2,8 +2,10 @@
 #ifndef _BATTLE_H_
 #define _BATTLE_H_
 
+#include "GameMaster.h"
 #include "Player.h"
 #include "TimelineEvent.h"
+#include "TraceWriter.h"
 
 #include <vector>
 
@@ -36,8 +38,19 @@ public:
 	void init();
 	void start();
 	PvEBattleOutcome get_outcome(int);
+
+	/**
+	 * same as above, but into @param outcome, reusing the capacity of its vectors.
+	 */
+	void get_outcome(int, PvEBattleOutcome &outcome);
 	const std::vector<TimelineEvent> &get_log();
 
+	/**
+	 * add @param log of a battle between these players to @param trace as process @param pid, one track per player.
+	 * Moves, dodges and entries become spans, damage and exits become instants.
+	 */
+	void write_trace(TraceWriter &trace, unsigned pid, const std::vector<TimelineEvent> &log) const;
+
 protected:
 	struct PlayerState
 	{
@@ -95,6 +108,9 @@ private:
 	std::vector<TimelineEvent> m_event_queue;
 	std::vector<TimelineEvent> m_event_history;
 
+	// game master pinned to the calling thread at init()
+	const GameMaster *m_game_master{nullptr};
+
 	PlayerState m_player_states[MAX_NUM_PLAYERS];
 	Player_Index_t m_players_count{0};
 
@@ -1,9 +1,15 @@
-
 #ifndef _BATTLE_MATRIX_H_
 #define _BATTLE_MATRIX_H_
 
+#include "GameMaster.h"
 #include "SimplePvPBattle.h"
+#include "MatrixWriter.h"
+#include "PerfCounters.h"
+#include "RunProgress.h"
+#include "TraceWriter.h"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 namespace GoBattleSim
@@ -16,6 +22,10 @@ double get_battle_score(const PvPPokemon &pkm1,
 						int num_shields_1,
 						int num_shields_2);
 
+/**
+ * Identical builds (same types, stats, moves and shields) are simulated only once,
+ * and their results are copied to every row/column they appear in.
+ */
 class BattleMatrix
 {
 public:
@@ -23,17 +33,82 @@ public:
 			 const std::vector<PvPPokemon> &col_pokemon,
 			 bool average_by_shield);
 
+	/**
+	 * If @param writer is not NULL, stream finished rows to it instead of keeping the matrix in memory.
+	 */
+	void set_writer(MatrixWriter *writer);
+
+	/**
+	 * Mark the matrix as a tile at (@param row_offset, @param col_offset) of a larger matrix.
+	 * The offsets are only recorded in the output file header. set() resets this to the full matrix.
+	 */
+	void set_tile(unsigned row_offset, unsigned col_offset, unsigned total_rows, unsigned total_cols);
+
+	/**
+	 * If @param progress is not NULL, count finished cells of unique builds in it, and stop when it is cancelled.
+	 * Cells not computed before cancellation are NaN.
+	 */
+	void set_progress(RunProgress *progress);
+
+	/**
+	 * If @param seed is not negative, seed every cell from it and the two builds,
+	 * so a cell has the same result in any tile and on any thread.
+	 */
+	void set_seed(int64_t seed);
+
+	/**
+	 * If @param trace is not NULL, record the rows (or column ranges) computed by each worker thread in it.
+	 */
+	void set_trace(TraceWriter *trace);
+
 	void run();
 
 	const Matrix_t &get() const;
 
+	/**
+	 * counters of the latest run, summed over its worker threads (only counted with GBS_PERF_COUNTERS)
+	 */
+	const PerfCounters &perf() const;
+
 protected:
+	void prepare_output();
+	void compute_row(unsigned row, unsigned col_first, unsigned col_last, double *out) const;
+	void run_rows(std::atomic<unsigned> &next_row);
+	void run_cols(unsigned col_first, unsigned col_last);
+	void scatter_row(unsigned unique_row, const double *unique_values, double *buf);
+	void merge_perf();
+
+	// unique builds only
 	std::vector<PvPPokemon> m_row_pkm;
 	std::vector<PvPPokemon> m_col_pkm;
 
+	// original row/column -> unique build
+	std::vector<unsigned> m_row_index;
+	std::vector<unsigned> m_col_index;
+	// unique row build -> original rows
+	std::vector<std::vector<unsigned>> m_row_members;
+	// hash of each unique build, to seed its cells
+	std::vector<uint64_t> m_row_hash;
+	std::vector<uint64_t> m_col_hash;
+
 	bool m_average_by_shield;
+	int64_t m_seed{-1};
+
+	unsigned m_row_offset{0};
+	unsigned m_col_offset{0};
+	unsigned m_total_rows{0};
+	unsigned m_total_cols{0};
 
 	Matrix_t m_matrix;
+	Matrix_t m_unique_matrix;
+	MatrixWriter *m_writer{nullptr};
+	RunProgress *m_progress{nullptr};
+	TraceWriter *m_trace{nullptr};
+	// game master pinned to the thread calling run(), pinned to its worker threads too
+	const GameMaster *m_game_master{nullptr};
+
+	PerfCounters m_perf;
+	std::mutex m_perf_mutex;
 };
 
 } // namespace GoBattleSim
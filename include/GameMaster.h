@@ -4,7 +4,8 @@
 
 namespace GoBattleSim
 {
-extern char err_msg[256];
+// per thread, so that simulations on different threads do not overwrite each other's errors
+extern thread_local char err_msg[256];
 
 constexpr unsigned MAX_NUM_TYPES = 20;
 constexpr unsigned MAX_NUM_STAGES = 16;
@@ -12,8 +13,24 @@ constexpr unsigned MAX_NUM_STAGES = 16;
 class GameMaster
 {
 public:
+	/**
+	 * The global game master, for setting it up before simulating on threads that pin none.
+	 */
 	static GameMaster &get();
 
+	/**
+	 * The game master pinned to the calling thread, or the global one if none is pinned.
+	 * Simulations only read it, so a pinned game master may be shared by any number of threads.
+	 */
+	static const GameMaster &current();
+
+	/**
+	 * Pin @param gm to the calling thread (NULL for the global one). It must not change while pinned.
+	 * 
+	 * @return the previously pinned game master
+	 */
+	static const GameMaster *bind(const GameMaster *gm);
+
 	GameMaster();
 
 	// Shared Battle Settings
@@ -22,6 +39,23 @@ public:
 	double effectiveness(int, int) const;
 	double effectiveness(unsigned, unsigned, double);
 
+	/**
+	 * index of the defender types (@param type1, @param type2) for dual_effectiveness(), where -1 is no type.
+	 */
+	static unsigned type_pair(int type1, int type2)
+	{
+		return type_index(type1) * (MAX_NUM_TYPES + 1) + type_index(type2);
+	}
+
+	/**
+	 * effectiveness of a move of @param move_type against both defender types of @param def_type_pair, without STAB.
+	 * Looked up in a table that is kept up to date by the setters.
+	 */
+	double dual_effectiveness(int move_type, unsigned def_type_pair) const
+	{
+		return m_dual_effectiveness[type_index(move_type)][def_type_pair];
+	}
+
 	unsigned max_energy{100};
 	double stab_multiplier{1.2};
 
@@ -49,6 +83,12 @@ public:
 	double charged_attack_bonus_multiplier{1.3};
 
 	void set_stage_bounds(int, int);
+
+	/**
+	 * Throw if min_stage and max_stage (which may also be set directly) are not valid bounds.
+	 * Checked when PvP simulations are prepared, so that buffs need no checks.
+	 */
+	void check_stage_bounds() const;
 	double atk_stage_multiplier(int) const;
 	double atk_stage_multiplier(int, double);
 	double def_stage_multiplier(int) const;
@@ -56,13 +96,49 @@ public:
 
 private:
 	static GameMaster instance;
+	static thread_local const GameMaster *bound;
 
 	unsigned m_num_types{0};
 	double m_type_effectiveness[MAX_NUM_TYPES][MAX_NUM_TYPES];
+	// [move type + 1][type_pair(defender type 1, defender type 2)]
+	double m_dual_effectiveness[MAX_NUM_TYPES + 1][(MAX_NUM_TYPES + 1) * (MAX_NUM_TYPES + 1)];
 	int m_type_boosted_weathers[MAX_NUM_TYPES];
 
 	double m_atk_stage_multipliers[MAX_NUM_STAGES];
 	double m_def_stage_multipliers[MAX_NUM_STAGES];
+
+	void update_dual_effectiveness(int move_type);
+
+	/**
+	 * row or column of @param type in the dual effectiveness table. Types out of range have none,
+	 * which is 1x like effectiveness() of them, so that types set through the C++ API cannot index past the table.
+	 */
+	static unsigned type_index(int type)
+	{
+		return static_cast<unsigned>(type) < MAX_NUM_TYPES ? type + 1 : 0;
+	}
+};
+
+/**
+ * Pin a game master to the calling thread until the end of the scope.
+ */
+class GameMasterScope
+{
+public:
+	explicit GameMasterScope(const GameMaster *gm) : m_prev(GameMaster::bind(gm))
+	{
+	}
+
+	~GameMasterScope()
+	{
+		GameMaster::bind(m_prev);
+	}
+
+	GameMasterScope(const GameMasterScope &) = delete;
+	GameMasterScope &operator=(const GameMasterScope &) = delete;
+
+private:
+	const GameMaster *m_prev;
 };
 
 } // namespace GoBattleSim
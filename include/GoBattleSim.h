@@ -3,6 +3,7 @@
 #define _GOBATTLESIM_H_
 
 #include "GameMaster.h"
+#include "Random.h"
 
 #include "Move.h"
 #include "Pokemon.h"
@@ -14,6 +15,8 @@
 #include "PvPPokemon.h"
 #include "PvPStrategy.h"
 #include "SimplePvPBattle.h"
+#include "MatrixWriter.h"
 #include "BattleMatrix.h"
+#include "TeamSearch.h"
 
 #endif
@@ -14,11 +14,24 @@
 #define FUNCTION_PREFIX
 #endif
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+	/**
+	 * Encodings of input and output for GBS_prepare_encoded() and GBS_collect_encoded().
+	 */
+	enum GBS_Encoding
+	{
+		GBS_ENCODING_JSON = 0,		   // indented text, same as GBS_collect()
+		GBS_ENCODING_JSON_COMPACT = 1, // text without white space
+		GBS_ENCODING_CBOR = 2,
+		GBS_ENCODING_MSGPACK = 3
+	};
+
 	/**
 	 * Return the version string in the format "{major}.{minor}.{patch}".
 	 */
@@ -36,6 +49,13 @@ extern "C"
      */
 	void FUNCTION_PREFIX GBS_prepare(const char *input_j);
 
+	/**
+	 * Same as GBS_prepare(), with the input in @param encoding (one of GBS_Encoding).
+	 * 
+	 * @param input input of @param input_size bytes, which does not need to be null-terminated
+	 */
+	void FUNCTION_PREFIX GBS_prepare_encoded(const void *input, size_t input_size, int encoding);
+
 	/**
      * Run the new simulation configured by the latest GBS_prepare().
      */
@@ -48,13 +68,170 @@ extern "C"
      */
 	const char *FUNCTION_PREFIX GBS_collect();
 
+	/**
+	 * Same as GBS_collect(), with the output in @param encoding (one of GBS_Encoding).
+	 * 
+	 * @param output_size set to the size of the output in bytes, if not NULL
+	 * @return the output, in the same buffer as GBS_collect()
+	 */
+	const void *FUNCTION_PREFIX GBS_collect_encoded(int encoding, size_t *output_size);
+
+	/**
+	 * Run many simulations in one call, spread across threads.
+	 * It does not touch the simulation of GBS_prepare()/GBS_run(), and the game master is shared by all inputs.
+	 * The returned string is in the same buffer as the one returned by GBS_collect() and GBS_config().
+	 *
+	 * @param inputs_j a JSON array of simulation inputs, or JSON Lines with one input per line
+	 * @return the outputs in input order, as a JSON array or JSON Lines like the input.
+	 *         An input that fails gets {"error": message} as its output.
+	 */
+	const char *FUNCTION_PREFIX GBS_batch(const char *inputs_j);
+
+	/**
+	 * Get the progress of the running (or latest) GBS_run(), in sims for PvE/PvP and in cells for battle matrix.
+	 * May be called from another thread while GBS_run() is going.
+	 *
+	 * @param num_done number of sims/cells finished, if not NULL
+	 * @param num_total number of sims/cells in the run, if not NULL
+	 */
+	void FUNCTION_PREFIX GBS_progress(unsigned long long *num_done, unsigned long long *num_total);
+
+	/**
+	 * Ask the running (or next) GBS_run() to stop after the current sim/cell.
+	 * Output finished so far stays collectable; battle matrix cells not computed are null.
+	 * May be called from another thread. The next GBS_prepare() clears it.
+	 */
+	void FUNCTION_PREFIX GBS_cancel();
+
 	/**
 	 * If @param gm_j is not NULL, set GBS game master parameters by it.
+	 * The game master is replaced, never changed in place: a simulation keeps the game master it was prepared with,
+	 * so it is safe to call while other threads run simulations or batches.
 	 * 
 	 * @return GBS-format game master in JSON
 	 */
 	const char *FUNCTION_PREFIX GBS_config(const char *gm_j);
 
+	/**
+	 * Compile the game master @param gm_j into a binary snapshot file at @param path,
+	 * which GBS_load_snapshot() loads without parsing JSON. The game master in use is not changed.
+	 * A snapshot is only valid for the build of GoBattleSim that compiled it.
+	 */
+	void FUNCTION_PREFIX GBS_compile_snapshot(const char *gm_j, const char *path);
+
+	/**
+	 * Set GBS game master parameters from a snapshot file made by GBS_compile_snapshot(), like GBS_config().
+	 * Outputs cached for the game master JSON stay valid for its snapshot.
+	 */
+	void FUNCTION_PREFIX GBS_load_snapshot(const char *path);
+
+	/**
+	 * Cache the outputs of seeded inputs (with "seed" set), so that repeating an input answers it without simulating.
+	 * An output is keyed by the parsed input and the game master of the last GBS_config() (or GBS_config_ctx()).
+	 * Inputs with "outputFile" and cancelled runs are not cached. One cache is shared by all contexts and batches.
+	 *
+	 * @param max_entries number of outputs kept in memory, least recently used first out. 0 (the default) disables it.
+	 * @param dir if not NULL, an existing directory to also keep every output in, one file each, across processes
+	 */
+	void FUNCTION_PREFIX GBS_cache_config(size_t max_entries, const char *dir);
+
+	/**
+	 * Get the number of cache lookups answered and missed so far.
+	 */
+	void FUNCTION_PREFIX GBS_cache_stats(unsigned long long *num_hits, unsigned long long *num_misses);
+
+	/**
+	 * A simulation context owns its own simulation state, output buffer, error and game master,
+	 * so that different contexts can be used concurrently from different threads.
+	 * One context must not be used by two threads at the same time,
+	 * except for GBS_progress_ctx() and GBS_cancel_ctx().
+	 *
+	 * The functions below mirror the ones above. Instead of throwing, they return non-zero (or NULL)
+	 * on error, and the error message is kept by GBS_error_ctx().
+	 */
+	typedef struct GBS_Context GBS_Context;
+
+	/**
+	 * Create a new context. Its game master starts as the global one, shared until either is set again.
+	 */
+	GBS_Context *FUNCTION_PREFIX GBS_create_context();
+
+	void FUNCTION_PREFIX GBS_destroy_context(GBS_Context *ctx);
+
+	/**
+	 * Get the error message of the last failed call on @param ctx.
+	 */
+	const char *FUNCTION_PREFIX GBS_error_ctx(GBS_Context *ctx);
+
+	int FUNCTION_PREFIX GBS_prepare_ctx(GBS_Context *ctx, const char *input_j);
+
+	int FUNCTION_PREFIX GBS_prepare_encoded_ctx(GBS_Context *ctx, const void *input, size_t input_size, int encoding);
+
+	int FUNCTION_PREFIX GBS_run_ctx(GBS_Context *ctx);
+
+	/**
+	 * @return simulation output in JSON, owned by @param ctx and valid until the next call on it
+	 */
+	const char *FUNCTION_PREFIX GBS_collect_ctx(GBS_Context *ctx);
+
+	const void *FUNCTION_PREFIX GBS_collect_encoded_ctx(GBS_Context *ctx, int encoding, size_t *output_size);
+
+	/**
+	 * Same as GBS_collect_encoded_ctx(), but the output goes to a new buffer that stays valid,
+	 * across later calls on @param ctx, until it is passed to GBS_free_buffer_ctx() or the context is destroyed.
+	 * 
+	 * @param output_size set to the size of the output in bytes, if not NULL
+	 * @return the buffer, or NULL on error
+	 */
+	const void *FUNCTION_PREFIX GBS_collect_buffer_ctx(GBS_Context *ctx, int encoding, size_t *output_size);
+
+	/**
+	 * Release a buffer returned by GBS_collect_buffer_ctx().
+	 * 
+	 * @return 0, or non-zero if @param buffer is not a buffer of @param ctx
+	 */
+	int FUNCTION_PREFIX GBS_free_buffer_ctx(GBS_Context *ctx, const void *buffer);
+
+	const char *FUNCTION_PREFIX GBS_config_ctx(GBS_Context *ctx, const char *gm_j);
+
+	int FUNCTION_PREFIX GBS_load_snapshot_ctx(GBS_Context *ctx, const char *path);
+
+	const char *FUNCTION_PREFIX GBS_batch_ctx(GBS_Context *ctx, const char *inputs_j);
+
+	void FUNCTION_PREFIX GBS_progress_ctx(GBS_Context *ctx, unsigned long long *num_done, unsigned long long *num_total);
+
+	void FUNCTION_PREFIX GBS_cancel_ctx(GBS_Context *ctx);
+
+	/**
+	 * Called when a GBS_run_async() job is done, on an engine thread.
+	 *
+	 * @param status 0, or non-zero if the run failed (see GBS_error_ctx())
+	 */
+	typedef void (*GBS_Callback)(GBS_Context *ctx, int status, void *user_data);
+
+	/**
+	 * Start GBS_run_ctx() on the engine's thread pool and return at once.
+	 * Until the job is done, @param ctx must only be used by GBS_progress_ctx(), GBS_cancel_ctx(),
+	 * GBS_poll() and GBS_wait(). The output is then collected as usual.
+	 *
+	 * @param callback if not NULL, called with @param user_data when the run is done, before GBS_wait() returns.
+	 *        It may collect the output, but must not destroy the context.
+	 * @return 0, or non-zero if a job is already running on @param ctx
+	 */
+	int FUNCTION_PREFIX GBS_run_async(GBS_Context *ctx, GBS_Callback callback, void *user_data);
+
+	/**
+	 * @return 1 if no GBS_run_async() job (or its callback) is running on @param ctx, 0 if one is
+	 */
+	int FUNCTION_PREFIX GBS_poll(GBS_Context *ctx);
+
+	/**
+	 * Block until the GBS_run_async() job on @param ctx (if any) is done.
+	 *
+	 * @return status of the latest job, as passed to its callback
+	 */
+	int FUNCTION_PREFIX GBS_wait(GBS_Context *ctx);
+
 #ifdef __cplusplus
 }
 #endif
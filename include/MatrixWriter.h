@@ -0,0 +1,109 @@
+#ifndef _MATRIX_WRITER_H_
+#define _MATRIX_WRITER_H_
+
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace GoBattleSim
+{
+
+enum class MatrixFileFormat
+{
+	None, // keep the matrix in memory
+	CSV,
+	Float64,
+	Float32
+};
+
+/**
+ * Header of the binary matrix format. All fields are little-endian uint32,
+ * followed by num_rows * num_cols little-endian floats in row-major order.
+ *
+ * A file may hold a tile of a larger matrix, placed at (row_offset, col_offset)
+ * of a total_rows x total_cols matrix.
+ */
+struct MatrixFileHeader
+{
+	unsigned version{1};
+	unsigned element_size{8}; // 8 = float64, 4 = float32
+	unsigned num_rows{0};
+	unsigned num_cols{0};
+	unsigned row_offset{0};
+	unsigned col_offset{0};
+	unsigned total_rows{0};
+	unsigned total_cols{0};
+};
+
+constexpr char MATRIX_FILE_MAGIC[4] = {'G', 'B', 'S', 'M'};
+constexpr unsigned MATRIX_FILE_HEADER_SIZE = 40;
+
+/**
+ * Write battle matrix rows to a file as they are computed.
+ * write_row() is thread-safe and rows may arrive in any order.
+ * A failed write is kept, and thrown by close() once the file is closed.
+ */
+class MatrixWriter
+{
+public:
+	MatrixWriter(const std::string &path, MatrixFileFormat format);
+	~MatrixWriter();
+
+	void open(const MatrixFileHeader &);
+	void write_row(unsigned row, const double *values);
+	void close();
+
+	const std::string &path() const;
+	MatrixFileFormat format() const;
+	const MatrixFileHeader &header() const;
+
+private:
+	void write_binary_row(unsigned row, const double *values);
+	void write_csv_row(unsigned row, const double *values);
+	// with m_mutex held
+	void set_error();
+
+	std::string m_path;
+	MatrixFileFormat m_format;
+	MatrixFileHeader m_header;
+
+	FILE *m_file{nullptr};
+	std::mutex m_mutex;
+	// the first failed write since open(), empty if none
+	std::string m_error;
+
+	// CSV rows must be written in order, so out-of-order rows are held here
+	std::map<unsigned, std::string> m_pending_rows;
+	unsigned m_next_row{0};
+};
+
+/**
+ * Parse a format name ("csv", "float64" or "f64", "float32" or "f32"), ignoring case.
+ */
+MatrixFileFormat parse_matrix_file_format(std::string);
+const char *matrix_file_format_name(MatrixFileFormat);
+
+bool write_matrix_file_header(FILE *, const MatrixFileHeader &);
+bool read_matrix_file_header(FILE *, MatrixFileHeader &);
+
+/**
+ * Read a binary matrix file (or tile) into @param values in row-major order.
+ */
+void read_matrix_file(const std::string &path, MatrixFileHeader &header, std::vector<double> &values);
+
+/**
+ * Merge binary tiles of the same matrix into @param matrix.
+ */
+void merge_matrix_tiles(const std::vector<std::string> &paths, std::vector<std::vector<double>> &matrix);
+
+/**
+ * Merge binary tiles that each cover full rows of the same matrix into @param writer.
+ * Only one tile is held in memory at a time.
+ */
+void merge_matrix_tiles(const std::vector<std::string> &paths, MatrixWriter &writer);
+
+} // namespace GoBattleSim
+
+#endif
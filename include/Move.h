@@ -2,6 +2,10 @@
 #ifndef _MOVE_H_
 #define _MOVE_H_
 
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
 namespace GoBattleSim
 {
 
@@ -34,6 +38,75 @@ struct Move
 	}
 };
 
+bool operator==(const Move &, const Move &);
+
+struct MoveHash
+{
+	size_t operator()(const Move &move) const;
+};
+
+/**
+ * Interned moves: equal moves get the same address, which stays valid for the life of the pool.
+ * The process-wide pool is never cleared, so moves from client input go to a pool of their own,
+ * bound to the thread that prepares the input and dropped with it.
+ */
+class MovePool
+{
+public:
+	const Move *intern(const Move &move);
+
+	size_t size() const;
+
+	/**
+	 * the pool bound to the calling thread, or the process-wide one
+	 */
+	static MovePool &get();
+
+	/**
+	 * bind @param pool to the calling thread (NULL for the process-wide one), and return the previous one.
+	 */
+	static MovePool *bind(MovePool *pool);
+
+private:
+	mutable std::mutex m_mutex;
+	// a deque does not move its elements as it grows, so the addresses handed out stay valid
+	std::deque<Move> m_moves;
+	std::unordered_map<Move, const Move *, MoveHash> m_index;
+
+	static thread_local MovePool *bound;
+};
+
+/**
+ * Bind a move pool to the calling thread until the end of the scope.
+ */
+class MovePoolScope
+{
+public:
+	explicit MovePoolScope(MovePool *pool) : m_prev(MovePool::bind(pool))
+	{
+	}
+
+	~MovePoolScope()
+	{
+		MovePool::bind(m_prev);
+	}
+
+	MovePoolScope(const MovePoolScope &) = delete;
+	MovePoolScope &operator=(const MovePoolScope &) = delete;
+
+private:
+	MovePool *m_prev;
+};
+
+/**
+ * The interned copy of @param move in the pool bound to the calling thread (see MovePool).
+ * Moves are immutable once interned, so that Pokemon can share them instead of carrying copies.
+ */
+const Move *intern_move(const Move &move);
+
+// the interned Move() of the process-wide pool, the fast move of a Pokemon until one is added
+const Move *empty_move();
+
 } // namespace GoBattleSim
 
 #endif
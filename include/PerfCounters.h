@@ -0,0 +1,88 @@
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+#include "TimelineEvent.h"
+
+#include <stdint.h>
+
+/**
+ * Statements in GBS_PERF_COUNT() are only compiled with -DGBS_PERF_COUNTERS,
+ * so the hot paths carry no instrumentation otherwise.
+ */
+#ifdef GBS_PERF_COUNTERS
+#define GBS_PERF_COUNT(stmt) stmt
+#else
+#define GBS_PERF_COUNT(stmt)
+#endif
+
+namespace GoBattleSim
+{
+
+constexpr unsigned NUM_EVENT_TYPES = static_cast<unsigned>(EventType::Exit) + 1;
+
+enum class StrategyCallback : unsigned char
+{
+	OnFree,
+	OnClear,
+	OnAttack
+};
+
+constexpr unsigned NUM_STRATEGY_CALLBACKS = static_cast<unsigned>(StrategyCallback::OnAttack) + 1;
+
+/**
+ * What the battles of a run did, counted by the thread running them.
+ */
+struct PerfCounters
+{
+	uint64_t events[NUM_EVENT_TYPES]{};
+	uint64_t heap_pushes{0};
+	uint64_t heap_pops{0};
+	uint64_t peak_queue_depth{0};
+	uint64_t strategy_calls[NUM_STRATEGY_CALLBACKS]{};
+	uint64_t branch_nodes{0};
+
+	/**
+	 * the counters of the calling thread
+	 */
+	static PerfCounters &local()
+	{
+		static thread_local PerfCounters counters;
+		return counters;
+	}
+
+	void count_event(EventType type)
+	{
+		++events[static_cast<unsigned>(type)];
+	}
+
+	void count_call(StrategyCallback callback)
+	{
+		++strategy_calls[static_cast<unsigned>(callback)];
+	}
+
+	void count_push(uint64_t queue_depth)
+	{
+		++heap_pushes;
+		peak_queue_depth = queue_depth > peak_queue_depth ? queue_depth : peak_queue_depth;
+	}
+
+	void merge(const PerfCounters &other)
+	{
+		for (unsigned i = 0; i < NUM_EVENT_TYPES; ++i)
+		{
+			events[i] += other.events[i];
+		}
+		heap_pushes += other.heap_pushes;
+		heap_pops += other.heap_pops;
+		peak_queue_depth = other.peak_queue_depth > peak_queue_depth ? other.peak_queue_depth : peak_queue_depth;
+		for (unsigned i = 0; i < NUM_STRATEGY_CALLBACKS; ++i)
+		{
+			strategy_calls[i] += other.strategy_calls[i];
+		}
+		branch_nodes += other.branch_nodes;
+	}
+};
+
+} // namespace GoBattleSim
+
+#endif
@@ -11,20 +11,20 @@ constexpr unsigned MAX_NUM_CMOVES = 3;
 
 // forward declaration
 class Strategy;
+class GameMaster;
 
 class Pokemon
 {
 public:
 	Pokemon() = default;
 	Pokemon(int, int, double, double, int, int);
-	Pokemon(const Pokemon &);
-	Pokemon &operator=(const Pokemon &);
-	~Pokemon();
 
 	const Move *get_fmove(unsigned) const;
 	void add_fmove(const Move *);
 	const Move *get_cmove(unsigned) const;
 	unsigned get_cmoves_count() const;
+	// index of @param cmove, one of this Pokemon's charged moves
+	unsigned get_cmove_index(const Move *cmove) const;
 	void add_cmove(const Move *);
 	void erase_cmoves();
 
@@ -37,9 +37,10 @@ public:
 	int starting_energy{};
 	bool immortal{false};
 
-	Move fmove;
-	Move cmoves[MAX_NUM_CMOVES];
-	Move *cmove{nullptr};
+	// interned moves (see intern_move), shared by all copies
+	const Move *fmove{empty_move()};
+	const Move *cmoves[MAX_NUM_CMOVES]{};
+	const Move *cmove{nullptr};
 	unsigned cmoves_count{0};
 
 	const Strategy *strategy{nullptr};
@@ -51,6 +52,24 @@ int calc_damage(const Pokemon *attacker,
 				const Pokemon *defender,
 				double multiplier);
 
+// Same as above, under the rules of @param gm instead of GameMaster::current()
+int calc_damage(const Pokemon *attacker,
+				const Move *move,
+				const Pokemon *defender,
+				double multiplier,
+				const GameMaster &gm);
+
+// Same as above, with the defender's types given as GameMaster::type_pair(defender->poketype1, defender->poketype2)
+int calc_damage(const Pokemon *attacker,
+				const Move *move,
+				const Pokemon *defender,
+				unsigned defender_type_pair,
+				double multiplier,
+				const GameMaster &gm);
+
+// Max HP from the base stamina, the stamina IV and the CP multiplier, which is at least 10 like in the game
+int calc_max_hp(int base_stm, int iv, double cpm);
+
 } // namespace GoBattleSim
 
 #endif
\ No newline at end of file
@@ -5,6 +5,8 @@
 namespace GoBattleSim
 {
 
+class GameMaster;
+
 struct PokemonState
 {
 	bool active{false};
@@ -24,7 +26,7 @@ struct PokemonState
 	void init();
 	void heal();
 	bool is_alive() const;
-	void charge(int);
+	void charge(int, const GameMaster &);
 	void hurt(int);
 	void attribute_damage(unsigned, bool);
 };
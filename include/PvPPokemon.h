@@ -1,7 +1,7 @@
-
 #ifndef _PVP_POKEMON_H_
 #define _PVP_POKEMON_H_
 
+#include "GameMaster.h"
 #include "Pokemon.h"
 
 namespace GoBattleSim
@@ -12,10 +12,17 @@ class PvPPokemon : public Pokemon
 public:
 	PvPPokemon() = default;
 	PvPPokemon(int, int, double, double, int, int);
-	PvPPokemon(const PvPPokemon &);
+	PvPPokemon(const PvPPokemon &) = default;
 	~PvPPokemon();
 
+	/**
+	 * reset the stages, and work out the attack and defense at every stage of the game master
+	 */
 	void init();
+
+	/**
+	 * change the stages by the deltas, within the stage bounds of the game master at init()
+	 */
 	void buff(int, int);
 
 	double attack_init{0.0};
@@ -24,6 +31,13 @@ public:
 	int defense_stage{0};
 
 	int num_shields_max{0};
+
+private:
+	// attack and defense at each stage, from m_min_stage to m_max_stage
+	double m_stage_attacks[MAX_NUM_STAGES]{};
+	double m_stage_defenses[MAX_NUM_STAGES]{};
+	int m_min_stage{0};
+	int m_max_stage{0};
 };
 
 } // namespace GoBattleSim
@@ -21,6 +21,8 @@ struct PvPStrategyInput
 
 	int subject_shields;
 	int enemy_shields;
+
+	const GameMaster *game_master;
 };
 
 typedef void (*PvPEventResponder)(const PvPStrategyInput &, Action *);
@@ -0,0 +1,45 @@
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+#include <stdint.h>
+
+namespace GoBattleSim
+{
+
+/**
+ * Random numbers for battles. Each thread has its own state, so a seeded run gives the same result
+ * no matter what other threads do. Without a seed, every thread starts from the same default state, like rand().
+ */
+constexpr int RANDOM_MAX = 0x7fffffff;
+
+inline uint64_t &random_state()
+{
+	static thread_local uint64_t state = 0x853c49e6748fea9bULL;
+	return state;
+}
+
+inline void seed_random(uint64_t seed)
+{
+	// splitmix64, so that close seeds give unrelated states (and the state is never 0)
+	uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+	random_state() = z != 0 ? z : 1;
+}
+
+/**
+ * A random integer in [0, RANDOM_MAX] (xorshift64*).
+ */
+inline int random_int()
+{
+	auto &x = random_state();
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	return static_cast<int>((x * 0x2545f4914f6cdd1dULL) >> 33);
+}
+
+} // namespace GoBattleSim
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef _REQUEST_SERVER_H_
+#define _REQUEST_SERVER_H_
+
+#include "GoBattleSim_extern.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace GoBattleSim
+{
+
+/**
+ * Serve simulation requests with a fixed set of worker threads, each with its own simulation context.
+ *
+ * A request is a simulation input with an optional "id". Its response is
+ * {"id": id, "output": output} or {"id": id, "error": message} in compact JSON.
+ * Responses go out as soon as they are ready, so they may be out of request order with more than one worker.
+ *
+ * At most one request per worker is in flight. When @param max_queue requests are already waiting,
+ * new ones are rejected with an error instead of queued.
+ * The request {"command": "stats"} is answered right away with counters and latency percentiles.
+ */
+class RequestServer
+{
+public:
+	typedef std::function<void(const std::string &)> Reply_t;
+
+	/**
+	 * Start @param num_workers workers. Contexts are copies of the global game master at this point.
+	 * @param max_queue 0 means no limit
+	 */
+	explicit RequestServer(unsigned num_workers, unsigned max_queue = 0);
+
+	/**
+	 * Wait for all queued requests to finish, then stop the workers.
+	 */
+	~RequestServer();
+
+	/**
+	 * Queue @param request, and call @param reply with its response on a worker thread.
+	 * Commands and rejected requests are replied to on the calling thread.
+	 */
+	void submit(std::string request, Reply_t reply);
+
+	/**
+	 * Block until every submitted request has been replied to.
+	 */
+	void wait_idle();
+
+	/**
+	 * Serve JSON Lines from @param in until the end, writing responses to @param out.
+	 */
+	void serve(std::istream &in, std::ostream &out);
+
+	/**
+	 * Handle one request on the calling thread with @param ctx.
+	 */
+	static std::string handle(GBS_Context *ctx, const std::string &request);
+
+	/**
+	 * Counters and latency percentiles (in milliseconds, over recent requests) in JSON.
+	 */
+	std::string stats();
+
+private:
+	typedef std::chrono::steady_clock Clock_t;
+
+	struct Job
+	{
+		std::string request;
+		Reply_t reply;
+		Clock_t::time_point submit_time;
+	};
+
+	void work();
+	void record_latency(double latency_ms);
+	bool handle_command(const std::string &request, const Reply_t &reply);
+
+	std::vector<std::thread> m_workers;
+	std::deque<Job> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::condition_variable m_idle;
+	unsigned m_num_running{0};
+	unsigned m_max_queue{0};
+	bool m_stopping{false};
+
+	// guarded by m_stats_mutex
+	std::mutex m_stats_mutex;
+	uint64_t m_num_done{0};
+	uint64_t m_num_rejected{0};
+	std::vector<double> m_latencies; // ring buffer of the latest requests
+	size_t m_next_latency{0};
+};
+
+} // namespace GoBattleSim
+
+#endif
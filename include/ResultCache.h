@@ -0,0 +1,64 @@
+#ifndef _RESULT_CACHE_H_
+#define _RESULT_CACHE_H_
+
+#include <list>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+namespace GoBattleSim
+{
+
+/**
+ * 128-bit FNV-1a hash of @param data, in 32 hex digits.
+ */
+std::string hash_key(const std::string &data);
+
+/**
+ * Simulation outputs by key, in a least-recently-used memory cache and optionally in a directory,
+ * one file per key. Thread-safe; one cache is shared by the whole process.
+ */
+class ResultCache
+{
+public:
+	static ResultCache &get();
+
+	/**
+	 * Keep up to @param max_entries outputs in memory (0 to disable),
+	 * and store them in @param dir as well if it is not empty.
+	 */
+	void configure(size_t max_entries, const std::string &dir);
+
+	bool enabled() const;
+
+	bool find(const std::string &key, std::string &value);
+	void insert(const std::string &key, const std::string &value);
+	/**
+	 * Remove the entry of @param key, found but unreadable, from memory and the directory.
+	 * The find() that returned it is counted as a miss instead.
+	 */
+	void discard(const std::string &key);
+
+	uint64_t num_hits() const;
+	uint64_t num_misses() const;
+
+private:
+	static ResultCache instance;
+
+	void insert_memory(const std::string &key, const std::string &value);
+
+	mutable std::mutex m_mutex;
+	size_t m_max_entries{0};
+	std::string m_dir;
+	uint64_t m_num_hits{0};
+	uint64_t m_num_misses{0};
+
+	// most recently used first
+	std::list<std::pair<std::string, std::string>> m_entries;
+	std::unordered_map<std::string, std::list<std::pair<std::string, std::string>>::iterator> m_index;
+};
+
+} // namespace GoBattleSim
+
+#endif
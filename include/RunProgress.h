@@ -0,0 +1,39 @@
+#ifndef _RUN_PROGRESS_H_
+#define _RUN_PROGRESS_H_
+
+#include <atomic>
+#include <stdint.h>
+
+namespace GoBattleSim
+{
+
+/**
+ * Progress of a long run, and a flag to stop it early.
+ * All members may be read or set from another thread while the run is going.
+ */
+struct RunProgress
+{
+	std::atomic<uint64_t> num_done{0};
+	std::atomic<uint64_t> num_total{0};
+	std::atomic<bool> cancelled{false};
+
+	void reset(uint64_t total)
+	{
+		num_done = 0;
+		num_total = total;
+	}
+
+	void add_done(uint64_t count = 1)
+	{
+		num_done.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	bool is_cancelled() const
+	{
+		return cancelled.load(std::memory_order_relaxed);
+	}
+};
+
+} // namespace GoBattleSim
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _SHARD_COORDINATOR_H_
+#define _SHARD_COORDINATOR_H_
+
+#include <string>
+#include <vector>
+
+namespace GoBattleSim
+{
+
+/**
+ * Split a battle matrix input into row bands, run each band in a separate gbs process,
+ * and merge the binary tiles they write.
+ *
+ * Workers are either local processes (a fork + exec of the gbs binary)
+ * or shell commands from a hosts file, one per line, that the tile input and game master paths are appended to,
+ * e.g. "ssh node1 /opt/gbs/gbs". Remote workers must see the same scratch directory (TMPDIR) as the coordinator.
+ */
+struct ShardOptions
+{
+	std::string gbs_path;		   // binary to exec for local workers
+	unsigned num_workers{0};	   // local workers, used when worker_commands is empty
+	std::vector<std::string> worker_commands;
+	std::string game_master_path; // may be empty
+};
+
+std::vector<std::string> read_worker_commands(const std::string &hosts_path);
+
+/**
+ * Run @param input (a battle matrix input in JSON) sharded, and return the same JSON output gbs would print.
+ */
+std::string run_sharded(const std::string &input, const ShardOptions &options);
+
+} // namespace GoBattleSim
+
+#endif
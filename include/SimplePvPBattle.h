@@ -2,9 +2,11 @@
 #ifndef _SIMPLE_PVP_BATTLE_H_
 #define _SIMPLE_PVP_BATTLE_H_
 
+#include "GameMaster.h"
 #include "PvPPokemon.h"
 #include "PvPStrategy.h"
 #include "TimelineEvent.h"
+#include "TraceWriter.h"
 
 #include <vector>
 
@@ -48,6 +50,12 @@ public:
 	void start();
 	SimplePvPBattleOutcome get_outcome();
 
+	/**
+	 * add @param log of a battle between these Pokemon to @param trace as process @param pid, one track per player.
+	 * A turn is 500 ms.
+	 */
+	void write_trace(TraceWriter &trace, unsigned pid, const std::vector<TimelineEvent> &log) const;
+
 protected:
 	void go();
 
@@ -59,12 +67,20 @@ protected:
 	void handle_move_effect(Player_Index_t, const MoveEffect &);
 	void handle_fainted_pokemon(Player_Index_t);
 
+	/**
+	 * get branch @param k as a copy of this battle. Branch nodes are kept for the next battle to reuse.
+	 */
+	SimplePvPBattle *make_branch(int k);
+	void copy_state(const SimplePvPBattle &other);
+
 	void append_log(TimelineEvent &&);
 	void erase_log();
 
 	PvPStrategyInput generate_strat_input(Player_Index_t);
 
 private:
+	// game master pinned to the calling thread at init(), shared with the branches
+	const GameMaster *m_game_master{nullptr};
 	PvPPokemon m_pkm[2];
 	int m_num_shields_max[2];
 	PvPStrategy m_strategies[2];
@@ -76,6 +92,7 @@ private:
 	std::vector<TimelineEvent> m_battle_log;
 
 	bool m_enable_branching{false};
+	bool m_branched{false};
 	SimplePvPBattle *m_branch[2]{nullptr, nullptr};
 	double m_branch_weight[2]{0.0, 0.0};
 };
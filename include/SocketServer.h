@@ -0,0 +1,40 @@
+#ifndef _SOCKET_SERVER_H_
+#define _SOCKET_SERVER_H_
+
+#include "RequestServer.h"
+
+#include <stddef.h>
+#include <string>
+
+namespace GoBattleSim
+{
+
+// max bytes of a request line; a connection sending a longer one gets an error and is closed
+constexpr size_t MAX_REQUEST_SIZE = 64 << 20;
+
+/**
+ * Accept connections on a Unix domain socket or a local TCP port, and pass their JSON Lines to a RequestServer.
+ * Each connection is read by its own thread; responses are written back to the connection they came from.
+ *
+ * @param address "unix:/path/to/socket", "host:port" or "port" (on 127.0.0.1); TCP hosts must be loopback addresses
+ */
+class SocketServer
+{
+public:
+	SocketServer(RequestServer &server, const std::string &address);
+	~SocketServer();
+
+	/**
+	 * Accept connections until the process is stopped.
+	 */
+	void run();
+
+private:
+	RequestServer &m_server;
+	std::string m_unix_path;
+	int m_fd{-1};
+};
+
+} // namespace GoBattleSim
+
+#endif
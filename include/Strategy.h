@@ -50,6 +50,8 @@ struct StrategyInput
 	int random_number;
 	// The weather
 	int weather;
+	// The rules of the battle
+	const GameMaster *game_master;
 };
 
 typedef void (*EventResponder)(const StrategyInput &, Action *);
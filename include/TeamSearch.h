@@ -0,0 +1,44 @@
+#ifndef _TEAM_SEARCH_H_
+#define _TEAM_SEARCH_H_
+
+#include "BattleMatrix.h"
+
+#include <vector>
+
+namespace GoBattleSim
+{
+
+constexpr unsigned TEAM_SIZE = 3;
+
+enum class TeamObjective
+{
+	Average, // mean over columns of the best member's score
+	Worst,	 // min over columns of the best member's score
+	Coverage // number of columns beaten by at least one member
+};
+
+struct TeamSearchOptions
+{
+	unsigned top_k{10};
+	// a member beats a column if its score is above this
+	double threshold{0.0};
+	TeamObjective objective{TeamObjective::Average};
+};
+
+struct TeamScore
+{
+	unsigned members[TEAM_SIZE];
+	double average{0.0};
+	double worst{0.0};
+	unsigned coverage{0};
+};
+
+/**
+ * Find the best teams of three rows of @param matrix against its columns.
+ * Every triple of rows is scored; the top ones are returned, best first.
+ */
+std::vector<TeamScore> search_teams(const Matrix_t &matrix, const TeamSearchOptions &options);
+
+} // namespace GoBattleSim
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef _TRACE_WRITER_H_
+#define _TRACE_WRITER_H_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#include <unordered_map>
+#endif
+
+namespace GoBattleSim
+{
+
+/**
+ * Collects spans and instants in the Chrome trace event format, to be viewed in chrome://tracing or Perfetto.
+ * A process (pid) groups tracks (tid); times are in microseconds.
+ * Events may be added from several threads.
+ */
+class TraceWriter
+{
+public:
+	/**
+	 * drop all events, and start recording if @param enabled. The time origin is now.
+	 */
+	void reset(bool enabled);
+
+	bool enabled() const;
+
+	/**
+	 * move the time origin back to @param origin, before any event is added
+	 */
+	void set_origin(std::chrono::steady_clock::time_point origin);
+
+	/**
+	 * microseconds since the time origin
+	 */
+	double now() const;
+
+	/**
+	 * a track number of the calling thread, 0 for the first thread seen
+	 */
+	unsigned thread_track();
+
+	/**
+	 * @param args is a JSON object, or empty for none
+	 */
+	void add_span(const std::string &name, const char *category, unsigned pid, unsigned tid, double ts, double dur,
+				  const std::string &args = std::string());
+	void add_instant(const std::string &name, const char *category, unsigned pid, unsigned tid, double ts,
+					 const std::string &args = std::string());
+	void name_process(unsigned pid, const std::string &name);
+	void name_track(unsigned pid, unsigned tid, const std::string &name);
+
+	void write(const std::string &path) const;
+
+private:
+	void add(std::string &&event);
+
+	bool m_enabled{false};
+	std::chrono::steady_clock::time_point m_origin;
+	mutable std::mutex m_mutex;
+	std::vector<std::string> m_events;
+#ifndef __EMSCRIPTEN__
+	std::unordered_map<std::thread::id, unsigned> m_thread_tracks;
+#endif
+};
+
+/**
+ * Records a span of the engine process (pid 0) on the calling thread's track, from construction to destruction,
+ * with @param index (of a sim or a row) as its argument unless it is negative.
+ * Does nothing if @param trace is NULL or not enabled.
+ */
+class TraceSpan
+{
+public:
+	TraceSpan(TraceWriter *trace, const char *name, long index = -1);
+	~TraceSpan();
+
+private:
+	TraceWriter *m_trace;
+	const char *m_name;
+	long m_index;
+	double m_start{0};
+};
+
+} // namespace GoBattleSim
+
+#endif
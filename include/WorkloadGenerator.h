@@ -0,0 +1,44 @@
+#ifndef _WORKLOAD_GENERATOR_H_
+#define _WORKLOAD_GENERATOR_H_
+
+#include <string>
+#include <vector>
+
+namespace GoBattleSim
+{
+
+constexpr unsigned NUM_WORKLOAD_MODES = 4;
+constexpr unsigned NUM_WORKLOAD_SIZES = 3;
+
+/**
+ * What a synthetic workload is made of. Each input picks its battle mode (raid, gym, PvP or battle matrix),
+ * then its size class (small, medium or large), with chances proportional to the weights.
+ *
+ * Size classes scale the number of players, gym defenders, sims and battle matrix rows and columns.
+ */
+struct WorkloadOptions
+{
+	unsigned num_inputs{100};
+	unsigned long seed{0};
+	double mode_weights[NUM_WORKLOAD_MODES]{4, 2, 3, 1};
+	double size_weights[NUM_WORKLOAD_SIZES]{6, 3, 1};
+};
+
+/**
+ * Parse "name:weight,..." (e.g. "raid:4,pvp:1") into @param weights, one for each of @param names in order.
+ * Names not in @param spec get a weight of 0.
+ */
+void parse_workload_weights(const std::string &spec, const std::vector<std::string> &names, double *weights);
+
+/**
+ * Sample simulation inputs (in compact JSON) from the species, moves, CP multipliers and raid tiers of
+ * @param game_master (a game master JSON such as GBS_GAME_MASTER.json).
+ *
+ * Pokemon are spelled out with their types, stats and moves, so that the inputs run with any game master
+ * that has their types and weathers. Every input is seeded, and the same options give the same inputs.
+ */
+std::vector<std::string> generate_workload(const std::string &game_master, const WorkloadOptions &options);
+
+} // namespace GoBattleSim
+
+#endif
@@ -1,6 +1,8 @@
 
 #include "Application.h"
 
+#include "Random.h"
+
 #include <stdexcept>
 #include <stdio.h>
 
@@ -16,9 +18,13 @@ GoBattleSimApp &GoBattleSimApp::get()
 
 void GoBattleSimApp::prepare(const PvESimInput &input)
 {
+    m_progress.cancelled = false;
     battle_mode = BattleMode::PvE;
     aggregation_mode = input.aggregation;
     m_num_sims = input.num_sims;
+    m_seed = input.seed;
+    m_trace_file = input.trace_file;
+    m_trace.reset(!m_trace_file.empty());
 
     if (input.time_limit <= 0)
     {
@@ -40,10 +46,15 @@ void GoBattleSimApp::prepare(const PvESimInput &input)
 
 void GoBattleSimApp::prepare(const PvPSimpleSimInput &input)
 {
+    m_progress.cancelled = false;
     battle_mode = BattleMode::PvP;
     aggregation_mode = input.aggregation;
     m_num_sims = input.num_sims;
+    m_seed = input.seed;
+    m_trace_file = input.trace_file;
+    m_trace.reset(!m_trace_file.empty());
 
+    GameMaster::current().check_stage_bounds();
     m_pvp_battle.set_pokemon(input.pokemon[0], input.pokemon[1]);
     m_pvp_battle.set_strategy(input.strateies[0], input.strateies[1]);
     m_pvp_battle.set_num_shields_max(input.num_shields[0], input.num_shields[1]);
@@ -58,56 +69,167 @@ void GoBattleSimApp::prepare(const PvPSimpleSimInput &input)
 
 void GoBattleSimApp::prepare(const BattleMatrixSimInput &input)
 {
+    m_progress.cancelled = false;
     battle_mode = BattleMode::BattleMatrix;
-    m_battle_matrix.set(input.row_pokemon, input.col_pokemon, input.averge_by_shield);
+    matrix_file_format = input.output_format;
+    team_search = input.team_search;
+    m_team_search_options = input.team_search_options;
+    m_teams.clear();
+    m_trace_file = input.trace_file;
+    m_trace.reset(!m_trace_file.empty());
+    GameMaster::current().check_stage_bounds();
+    if (team_search && matrix_file_format != MatrixFileFormat::None)
+    {
+        sprintf(err_msg, "team search needs the battle matrix in memory, cannot be used with an output file");
+        throw std::runtime_error(err_msg);
+    }
+    unsigned total_rows = input.row_pokemon.size(), total_cols = input.col_pokemon.size();
+    unsigned row_last = input.row_last > 0 ? input.row_last : total_rows;
+    unsigned col_last = input.col_last > 0 ? input.col_last : total_cols;
+    if (input.row_first > row_last || row_last > total_rows || input.col_first > col_last || col_last > total_cols)
+    {
+        sprintf(err_msg, "bad tile range: rows [%u, %u) of %u, cols [%u, %u) of %u",
+                input.row_first, row_last, total_rows, input.col_first, col_last, total_cols);
+        throw std::runtime_error(err_msg);
+    }
+    bool is_tile = row_last - input.row_first < total_rows || col_last - input.col_first < total_cols;
+    if (is_tile && matrix_file_format == MatrixFileFormat::CSV)
+    {
+        sprintf(err_msg, "a matrix tile can only be written in a binary format");
+        throw std::runtime_error(err_msg);
+    }
+    if (is_tile && team_search)
+    {
+        sprintf(err_msg, "team search needs the full battle matrix, cannot be used with a tile range");
+        throw std::runtime_error(err_msg);
+    }
+    if (is_tile)
+    {
+        std::vector<PvPPokemon> row_pokemon(input.row_pokemon.begin() + input.row_first, input.row_pokemon.begin() + row_last);
+        std::vector<PvPPokemon> col_pokemon(input.col_pokemon.begin() + input.col_first, input.col_pokemon.begin() + col_last);
+        m_battle_matrix.set(row_pokemon, col_pokemon, input.averge_by_shield);
+        m_battle_matrix.set_tile(input.row_first, input.col_first, total_rows, total_cols);
+    }
+    else
+    {
+        m_battle_matrix.set(input.row_pokemon, input.col_pokemon, input.averge_by_shield);
+    }
+    if (matrix_file_format != MatrixFileFormat::None)
+    {
+        m_matrix_writer.reset(new MatrixWriter(input.output_file, input.output_format));
+    }
+    else
+    {
+        m_matrix_writer.reset();
+    }
+    m_battle_matrix.set_writer(m_matrix_writer.get());
+    m_battle_matrix.set_progress(&m_progress);
+    m_battle_matrix.set_seed(input.seed);
+    m_battle_matrix.set_trace(&m_trace);
 }
 
 void GoBattleSimApp::run()
 {
+    GBS_PERF_COUNT(PerfCounters::local() = PerfCounters());
+    if (m_seed >= 0)
+    {
+        // battle matrix cells are seeded on their own
+        seed_random(m_seed);
+    }
     if (battle_mode == BattleMode::PvE)
     {
+        m_progress.reset(m_num_sims);
         if (aggregation_mode == AggregationMode::Average)
         {
             m_pve_output_avg = {};
-            for (unsigned i = 0; i < m_num_sims; ++i)
+            PvEBattleOutcome output;
+            unsigned num_done = 0;
+            for (; num_done < m_num_sims && !m_progress.is_cancelled(); ++num_done)
             {
+                TraceSpan span(&m_trace, "sim", num_done);
                 m_pve_battle.init();
                 m_pve_battle.start();
-                auto output = m_pve_battle.get_outcome(1);
+                m_pve_battle.get_outcome(1, output);
                 add_to(m_pve_output_avg, output);
+                m_progress.add_done();
+            }
+            if (num_done > 0)
+            {
+                div_by(m_pve_output_avg, num_done);
             }
-            div_by(m_pve_output_avg, m_num_sims);
         }
         else
         {
-            for (unsigned i = 0; i < m_num_sims; ++i)
+            for (unsigned i = 0; i < m_num_sims && !m_progress.is_cancelled(); ++i)
             {
+                TraceSpan span(&m_trace, "sim", i);
                 m_pve_battle.init();
                 m_pve_battle.start();
                 auto output = m_pve_battle.get_outcome(1);
                 m_pve_output.push_back(output);
+                m_progress.add_done();
             }
         }
     }
     else if (battle_mode == BattleMode::PvP)
     {
-        for (unsigned i = 0; i < m_num_sims; ++i)
+        m_progress.reset(m_num_sims);
+        for (unsigned i = 0; i < m_num_sims && !m_progress.is_cancelled(); ++i)
         {
+            TraceSpan span(&m_trace, "sim", i);
             m_pvp_battle.init();
             m_pvp_battle.start();
             auto output = m_pvp_battle.get_outcome();
             m_pvp_output.push_back(output);
+            m_progress.add_done();
         }
     }
     else if (battle_mode == BattleMode::BattleMatrix)
     {
         m_battle_matrix.run();
+        // teams cannot be ranked on a partial matrix
+        if (team_search && !m_progress.is_cancelled())
+        {
+            TraceSpan span(&m_trace, "team search");
+            m_teams = search_teams(m_battle_matrix.get(), m_team_search_options);
+        }
     }
     else
     {
         sprintf(err_msg, "unknown battle mode: %d", (int)battle_mode);
         throw std::runtime_error(err_msg);
     }
+    // matrix cells are counted by the worker threads
+    GBS_PERF_COUNT(m_perf = battle_mode == BattleMode::BattleMatrix ? m_battle_matrix.perf() : PerfCounters::local());
+    if (m_trace.enabled())
+    {
+        write_trace();
+    }
+}
+
+/**
+ * Add the battle logs to the trace, one process per sim after the engine's, and write it out.
+ */
+void GoBattleSimApp::write_trace()
+{
+    m_trace.name_process(0, "engine");
+    if (battle_mode == BattleMode::PvE)
+    {
+        for (unsigned i = 0; i < m_pve_output.size(); ++i)
+        {
+            m_trace.name_process(i + 1, "sim " + std::to_string(i));
+            m_pve_battle.write_trace(m_trace, i + 1, m_pve_output[i].battle_log);
+        }
+    }
+    else if (battle_mode == BattleMode::PvP)
+    {
+        for (unsigned i = 0; i < m_pvp_output.size(); ++i)
+        {
+            m_trace.name_process(i + 1, "sim " + std::to_string(i));
+            m_pvp_battle.write_trace(m_trace, i + 1, m_pvp_output[i].battle_log);
+        }
+    }
+    m_trace.write(m_trace_file);
 }
 
 void GoBattleSimApp::collect(std::vector<PvEBattleOutcome> &outputs)
@@ -127,6 +249,11 @@ void GoBattleSimApp::collect(std::vector<SimplePvPBattleOutcome> &outputs)
 
 void GoBattleSimApp::collect(SimplePvPBattleOutcome &output)
 {
+    if (m_pvp_output.empty())
+    {
+        // cancelled before the first sim
+        return;
+    }
     if (aggregation_mode == AggregationMode::Branching)
     {
         output = m_pvp_output.back();
@@ -151,7 +278,44 @@ void GoBattleSimApp::collect(Matrix_t &output)
     output = m_battle_matrix.get();
 }
 
-void GoBattleSimApp::add_to(PvEAverageBattleOutcome &sum, PvEBattleOutcome cur)
+void GoBattleSimApp::collect(BattleMatrixFileOutput &output)
+{
+    if (m_matrix_writer)
+    {
+        output.path = m_matrix_writer->path();
+        output.format = m_matrix_writer->format();
+        output.num_rows = m_matrix_writer->header().num_rows;
+        output.num_cols = m_matrix_writer->header().num_cols;
+    }
+}
+
+void GoBattleSimApp::collect(std::vector<TeamScore> &output)
+{
+    output = m_teams;
+}
+
+void GoBattleSimApp::progress(uint64_t &num_done, uint64_t &num_total) const
+{
+    num_done = m_progress.num_done;
+    num_total = m_progress.num_total;
+}
+
+void GoBattleSimApp::cancel()
+{
+    m_progress.cancelled = true;
+}
+
+const PerfCounters &GoBattleSimApp::perf() const
+{
+    return m_perf;
+}
+
+TraceWriter &GoBattleSimApp::trace()
+{
+    return m_trace;
+}
+
+void GoBattleSimApp::add_to(PvEAverageBattleOutcome &sum, const PvEBattleOutcome &cur)
 {
     auto pokemon_count = cur.pokemon_stats.size();
     if (sum.pokemon_stats.size() == 0)
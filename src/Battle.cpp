@@ -2,6 +2,8 @@
 #include "Battle.h"
 
 #include "GameMaster.h"
+#include "PerfCounters.h"
+#include "Random.h"
 
 #include <algorithm>
 #include <math.h>
@@ -96,6 +98,7 @@ void Battle::enqueue(TimelineEvent &&e)
 {
 	m_event_queue.emplace_back(std::move(e));
 	std::push_heap(m_event_queue.begin(), m_event_queue.end());
+	GBS_PERF_COUNT(PerfCounters::local().count_push(m_event_queue.size()));
 }
 
 TimelineEvent Battle::dequeue()
@@ -103,13 +106,17 @@ TimelineEvent Battle::dequeue()
 	auto e = m_event_queue.front();
 	std::pop_heap(m_event_queue.begin(), m_event_queue.end());
 	m_event_queue.pop_back();
+	GBS_PERF_COUNT(++PerfCounters::local().heap_pops);
 	return e;
 }
 
 void Battle::init()
 {
+	m_game_master = &GameMaster::current();
 	m_time = 0;
 	m_event_queue.clear();
+	// an action queues at most three events, plus an Enter or BackGroundDPS event per player
+	m_event_queue.reserve(4 * m_players_count);
 	m_defeated_team = -1;
 
 	erase_log();
@@ -175,6 +182,7 @@ void Battle::go()
 void Battle::next(const TimelineEvent &event)
 {
 	m_time = event.time;
+	GBS_PERF_COUNT(PerfCounters::local().count_event(event.type));
 	switch (event.type)
 	{
 	case EventType::Free:
@@ -219,8 +227,14 @@ void Battle::next(const TimelineEvent &event)
 
 PvEBattleOutcome Battle::get_outcome(int team)
 {
-	// From team team {team}'s perspective
 	PvEBattleOutcome outcome;
+	get_outcome(team, outcome);
+	return outcome;
+}
+
+void Battle::get_outcome(int team, PvEBattleOutcome &outcome)
+{
+	// From team team {team}'s perspective
 	outcome.duration = m_time;
 	outcome.win = (m_defeated_team != team && m_time < m_time_limit);
 
@@ -249,9 +263,8 @@ PvEBattleOutcome Battle::get_outcome(int team)
 	outcome.tdo = sum_tdo;
 	outcome.tdo_percent = (double)sum_tdo / sum_rival_max_hp;
 	outcome.num_deaths = sum_deaths;
-	outcome.pokemon_stats = std::vector<PokemonState>(m_pokemon_states, m_pokemon_states + m_pokemon_count);
-	outcome.battle_log = get_log();
-	return outcome;
+	outcome.pokemon_stats.assign(m_pokemon_states, m_pokemon_states + m_pokemon_count);
+	outcome.battle_log.assign(m_event_history.begin(), m_event_history.end());
 }
 
 const std::vector<TimelineEvent> &Battle::get_log()
@@ -279,15 +292,15 @@ void Battle::handle_fainted_pokemon(Player_Index_t player_idx)
 	unsigned time_new_enter = 0;
 	if (select_next_pokemon(ps)) // Select next Pokemon from current party
 	{
-		time_new_enter = m_time + GameMaster::get().swap_duration;
+		time_new_enter = m_time + m_game_master->swap_duration;
 	}
 	else if (revive_current_party(ps)) // Max revive current party and re-lobby
 	{
-		time_new_enter = m_time + GameMaster::get().rejoin_duration + GameMaster::get().item_menu_time + party->get_pokemon_count() * GameMaster::get().pokemon_revive_time;
+		time_new_enter = m_time + m_game_master->rejoin_duration + m_game_master->item_menu_time + party->get_pokemon_count() * m_game_master->pokemon_revive_time;
 	}
 	else if (select_next_party(ps)) // Select next Party and re-lobby
 	{
-		time_new_enter = m_time + GameMaster::get().rejoin_duration + ps.player.get_head_party()->enter_delay;
+		time_new_enter = m_time + m_game_master->rejoin_duration + ps.player.get_head_party()->enter_delay;
 	}
 
 	if (time_new_enter > 0) // Player chose a new head Pokemon
@@ -413,9 +426,9 @@ void Battle::register_action_fast(Player_Index_t player_idx, const Action &t_act
 	auto time_action_start = m_time + t_action.delay;
 	if (ps.player.team != 0)
 	{
-		time_action_start += GameMaster::get().fast_attack_lag;
+		time_action_start += m_game_master->fast_attack_lag;
 	}
-	auto move = &m_pokemon[ps.head_index]->fmove;
+	auto move = m_pokemon[ps.head_index]->fmove;
 	enqueue({time_action_start + move->dws,
 			 EventType::Fast,
 			 player_idx,
@@ -423,7 +436,7 @@ void Battle::register_action_fast(Player_Index_t player_idx, const Action &t_act
 	ps.time_free = time_action_start + move->duration;
 	if (ps.player.team == 0)
 	{
-		ps.time_free += (rand() % 1000 + 1500);
+		ps.time_free += (random_int() % 1000 + 1500);
 		enqueue({time_action_start,
 				 EventType::Announce,
 				 player_idx,
@@ -442,7 +455,7 @@ void Battle::register_action_charged(Player_Index_t player_idx, const Action &t_
 	auto time_action_start = m_time + t_action.delay;
 	if (ps.player.team != 0)
 	{
-		time_action_start += GameMaster::get().charged_attack_lag;
+		time_action_start += m_game_master->charged_attack_lag;
 	}
 	if (pkm_st.energy + move->energy < 0)
 	{
@@ -456,7 +469,7 @@ void Battle::register_action_charged(Player_Index_t player_idx, const Action &t_
 	ps.time_free = time_action_start + move->duration;
 	if (ps.player.team == 0)
 	{
-		ps.time_free += (rand() % 1000 + 1500);
+		ps.time_free += (random_int() % 1000 + 1500);
 		enqueue({time_action_start,
 				 EventType::Announce,
 				 player_idx,
@@ -474,7 +487,7 @@ void Battle::register_action_dodge(Player_Index_t player_idx, const Action &t_ac
 	enqueue({time_action_start,
 			 EventType::Dodge,
 			 player_idx});
-	ps.time_free = time_action_start + GameMaster::get().dodge_duration;
+	ps.time_free = time_action_start + m_game_master->dodge_duration;
 	enqueue({ps.time_free,
 			 EventType::Free,
 			 player_idx});
@@ -488,7 +501,7 @@ void Battle::register_action_switch(Player_Index_t player_idx, const Action &t_a
 			 EventType::Enter,
 			 player_idx,
 			 search(ps.player.get_head_party()->get_pokemon(t_action.value))});
-	ps.time_free = time_action_start + GameMaster::get().swap_duration;
+	ps.time_free = time_action_start + m_game_master->swap_duration;
 }
 
 void Battle::register_action_wait(Player_Index_t player_idx, const Action &t_action)
@@ -519,8 +532,9 @@ StrategyInput Battle::generate_strat_input(Player_Index_t player_idx)
 		&m_pokemon_states[enemy_ps.head_index],
 		ps.current_action,
 		enemy_ps.current_action,
-		rand(),
-		m_weather};
+		random_int(),
+		m_weather,
+		m_game_master};
 	return strat_input;
 }
 
@@ -536,6 +550,7 @@ void Battle::handle_event_free(const TimelineEvent &event)
 	if (ps.buffer_action.type == ActionType::None) // No buffer action, call on_free
 	{
 		Action action;
+		GBS_PERF_COUNT(PerfCounters::local().count_call(StrategyCallback::OnFree));
 		ps.player.strategy.on_free(generate_strat_input(player_index), &action);
 		register_action(player_index, action);
 	}
@@ -546,6 +561,7 @@ void Battle::handle_event_free(const TimelineEvent &event)
 	}
 	if (ps.player.strategy.on_clear) // Ask for buffer action is on_clear is not NULL
 	{
+		GBS_PERF_COUNT(PerfCounters::local().count_call(StrategyCallback::OnClear));
 		ps.player.strategy.on_clear(generate_strat_input(player_index), &(ps.buffer_action));
 	}
 }
@@ -562,6 +578,7 @@ void Battle::handle_event_announce(const TimelineEvent &event)
 		}
 		if (ps.player.strategy.on_attack)
 		{
+			GBS_PERF_COUNT(PerfCounters::local().count_call(StrategyCallback::OnAttack));
 			if (ps.current_action.type == ActionType::None || ps.current_action.type == ActionType::Wait)
 			{
 				Action action;
@@ -596,12 +613,12 @@ void Battle::handle_event_attack(const TimelineEvent &event)
 		move = subject->get_cmove(event.value);
 		++subject_st.num_cmoves_used;
 	}
-	subject_st.charge(move->energy);
+	subject_st.charge(move->energy, *m_game_master);
 
 	double multiplier = ps.player.attack_multiplier;
-	if (GameMaster::get().boosted_weather(move->poketype) == m_weather)
+	if (m_game_master->boosted_weather(move->poketype) == m_weather)
 	{
-		multiplier *= GameMaster::get().wab_multiplier;
+		multiplier *= m_game_master->wab_multiplier;
 	}
 
 	for (Player_Index_t i = 0; i < m_players_count; ++i)
@@ -617,15 +634,15 @@ void Battle::handle_event_attack(const TimelineEvent &event)
 		{
 			continue;
 		}
-		auto damage = calc_damage(subject, move, opponent, multiplier) * ps.player.clone_multiplier;
+		auto damage = calc_damage(subject, move, opponent, multiplier, *m_game_master) * ps.player.clone_multiplier;
 		if (m_time < opponent_st.damage_reduction_expiry)
 		{
-			damage = (1 - GameMaster::get().dodge_damage_reduction_percent) * damage;
+			damage = (1 - m_game_master->dodge_damage_reduction_percent) * damage;
 			damage = damage > 0 ? damage : 1;
 		}
 		subject_st.attribute_damage(damage, event.type == EventType::Fast);
 		opponent_st.hurt(damage);
-		opponent_st.charge(ceil(GameMaster::get().energy_delta_per_health_lost * damage));
+		opponent_st.charge(ceil(m_game_master->energy_delta_per_health_lost * damage), *m_game_master);
 		if (m_enable_log)
 		{
 			append_log({m_time,
@@ -644,7 +661,7 @@ void Battle::handle_event_dodge(const TimelineEvent &event)
 {
 	auto &ps = m_player_states[event.player];
 	auto &pkm_st = m_pokemon_states[ps.head_index];
-	pkm_st.damage_reduction_expiry = m_time + GameMaster::get().dodge_window + 1;
+	pkm_st.damage_reduction_expiry = m_time + m_game_master->dodge_window + 1;
 }
 
 void Battle::handle_event_background_dps(const TimelineEvent &event)
@@ -653,7 +670,7 @@ void Battle::handle_event_background_dps(const TimelineEvent &event)
 	auto &pkm_st = m_pokemon_states[ps.head_index];
 	auto damage = event.value;
 	pkm_st.hurt(damage);
-	pkm_st.charge(ceil(GameMaster::get().energy_delta_per_health_lost * damage));
+	pkm_st.charge(ceil(m_game_master->energy_delta_per_health_lost * damage), *m_game_master);
 	if (!pkm_st.is_alive())
 	{
 		handle_fainted_pokemon(event.player);
@@ -694,6 +711,53 @@ void Battle::handle_event_enter(const TimelineEvent &event)
 	}
 }
 
+void Battle::write_trace(TraceWriter &trace, unsigned pid, const std::vector<TimelineEvent> &log) const
+{
+	for (Player_Index_t i = 0; i < m_players_count; ++i)
+	{
+		trace.name_track(pid, i, "player " + std::to_string(i) + " (team " + std::to_string(m_player_states[i].player.team) + ")");
+	}
+	// the head Pokemon of each player, followed through the Enter events
+	short heads[MAX_NUM_PLAYERS] = {};
+	for (const auto &event : log)
+	{
+		double ts = event.time * 1000.0;
+		auto pkm = m_pokemon[heads[event.player]];
+		const Move *move = nullptr;
+		switch (event.type)
+		{
+		case EventType::Enter:
+			heads[event.player] = event.value;
+			// until the first Free event, as in handle_event_enter()
+			trace.add_span("Enter", "battle", pid, event.player, ts,
+						   (m_player_states[event.player].player.team != 0 ? 500 : 2000) * 1000.0,
+						   "{\"pokemon\": " + std::to_string(event.value) + "}");
+			break;
+		case EventType::Fast:
+		case EventType::Charged:
+			// logged when the move hits, dws after it starts
+			move = event.type == EventType::Fast ? pkm->get_fmove(event.value) : pkm->get_cmove(event.value);
+			trace.add_span(event.type == EventType::Fast ? "Fast" : "Charged", "battle", pid, event.player,
+						   ts - move->dws * 1000.0, move->duration * 1000.0,
+						   "{\"power\": " + std::to_string(move->power) + ", \"dws\": " + std::to_string(move->dws) + "}");
+			break;
+		case EventType::Dodge:
+			trace.add_span("Dodge", "battle", pid, event.player, ts, m_game_master->dodge_duration * 1000.0);
+			break;
+		case EventType::Damage:
+		case EventType::BackGroundDPS:
+			trace.add_instant(event.type == EventType::Damage ? "Damage" : "BackGroundDPS", "battle", pid, event.player, ts,
+							  "{\"damage\": " + std::to_string(event.value) + "}");
+			break;
+		case EventType::Exit:
+			trace.add_instant("Exit", "battle", pid, event.player, ts, "{\"pokemon\": " + std::to_string(event.value) + "}");
+			break;
+		default:
+			break;
+		}
+	}
+}
+
 void Battle::append_log(const TimelineEvent &event)
 {
 	m_event_history.push_back(event);
@@ -1,6 +1,8 @@
 
 #include "BattleMatrix.h"
 
+#include "Random.h"
+
 /**
  * Emscripten does not support multi-threading well,
  * or at least I couldn't get it working with the compile flags:
@@ -15,6 +17,10 @@
 #include <thread>
 #endif
 
+#include <limits>
+#include <string>
+#include <unordered_map>
+
 namespace GoBattleSim
 {
 
@@ -30,54 +36,249 @@ double get_battle_score(const PvPPokemon &t_pkm_0, const PvPPokemon &t_pkm_1, in
 	return (tdo_0 < 1 ? tdo_0 : 1) - (tdo_1 < 1 ? tdo_1 : 1);
 }
 
+template <class T>
+static void append_bytes(std::string &key, const T &value)
+{
+	key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void append_move(std::string &key, const Move &move)
+{
+	append_bytes(key, move.poketype);
+	append_bytes(key, move.power);
+	append_bytes(key, move.energy);
+	append_bytes(key, move.duration);
+	append_bytes(key, move.dws);
+	append_bytes(key, move.effect.activation_chance);
+	append_bytes(key, move.effect.self_atk_delta);
+	append_bytes(key, move.effect.self_def_delta);
+	append_bytes(key, move.effect.target_atk_delta);
+	append_bytes(key, move.effect.target_def_delta);
+}
+
+/**
+ * Everything that affects the battle score, in a byte string.
+ */
+static std::string canonical_key(const PvPPokemon &pkm, bool ignore_shields)
+{
+	std::string key;
+	append_bytes(key, pkm.poketype1);
+	append_bytes(key, pkm.poketype2);
+	append_bytes(key, pkm.attack_init);
+	append_bytes(key, pkm.defense_init);
+	append_bytes(key, pkm.max_hp);
+	append_bytes(key, pkm.starting_energy);
+	append_bytes(key, pkm.immortal);
+	append_move(key, *pkm.fmove);
+	append_bytes(key, pkm.cmoves_count);
+	for (unsigned i = 0; i < pkm.cmoves_count; ++i)
+	{
+		append_move(key, *pkm.cmoves[i]);
+	}
+	append_bytes(key, pkm.cmove != nullptr ? static_cast<int>(pkm.get_cmove_index(pkm.cmove)) : -1);
+	if (!ignore_shields)
+	{
+		append_bytes(key, pkm.num_shields_max);
+	}
+	return key;
+}
+
+static uint64_t hash_bytes(const std::string &key)
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (unsigned char c : key)
+	{
+		hash = (hash ^ c) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static void deduplicate(const std::vector<PvPPokemon> &pkm_list,
+						bool ignore_shields,
+						std::vector<PvPPokemon> &unique_pkm,
+						std::vector<unsigned> &index,
+						std::vector<uint64_t> &hashes)
+{
+	std::unordered_map<std::string, unsigned> key_to_index;
+	unique_pkm.clear();
+	index.clear();
+	hashes.clear();
+	for (const auto &pkm : pkm_list)
+	{
+		auto key = canonical_key(pkm, ignore_shields);
+		auto res = key_to_index.emplace(key, unique_pkm.size());
+		if (res.second)
+		{
+			unique_pkm.push_back(pkm);
+			hashes.push_back(hash_bytes(key));
+		}
+		index.push_back(res.first->second);
+	}
+}
+
 void BattleMatrix::set(const std::vector<PvPPokemon> &row_pokemon,
 					   const std::vector<PvPPokemon> &col_pokemon,
 					   bool average_by_shield)
 {
-	m_row_pkm = row_pokemon;
-	m_col_pkm = col_pokemon;
 	m_average_by_shield = average_by_shield;
 
-	m_matrix.clear();
-	for (size_t i = 0; i < row_pokemon.size(); ++i)
+	// the number of shields is fixed when averaging by shield
+	deduplicate(row_pokemon, average_by_shield, m_row_pkm, m_row_index, m_row_hash);
+	deduplicate(col_pokemon, average_by_shield, m_col_pkm, m_col_index, m_col_hash);
+
+	m_row_members.assign(m_row_pkm.size(), std::vector<unsigned>());
+	for (unsigned i = 0; i < m_row_index.size(); ++i)
 	{
-		m_matrix.push_back(std::vector<double>(m_col_pkm.size()));
+		m_row_members[m_row_index[i]].push_back(i);
 	}
+
+	set_tile(0, 0, m_row_index.size(), m_col_index.size());
+
+	m_matrix.clear();
+	m_unique_matrix.clear();
 }
 
-void worker(Matrix_t &matrix,
-			const std::vector<PvPPokemon> &row_pkm,
-			const std::vector<PvPPokemon> &col_pkm,
-			unsigned row_first,
-			unsigned row_last,
-			unsigned col_first,
-			unsigned col_last,
-			bool averge_by_shield)
+void BattleMatrix::set_writer(MatrixWriter *writer)
 {
-	if (averge_by_shield)
+	m_writer = writer;
+}
+
+void BattleMatrix::set_progress(RunProgress *progress)
+{
+	m_progress = progress;
+}
+
+void BattleMatrix::set_seed(int64_t seed)
+{
+	m_seed = seed;
+}
+
+void BattleMatrix::set_trace(TraceWriter *trace)
+{
+	m_trace = trace;
+}
+
+void BattleMatrix::set_tile(unsigned row_offset, unsigned col_offset, unsigned total_rows, unsigned total_cols)
+{
+	m_row_offset = row_offset;
+	m_col_offset = col_offset;
+	m_total_rows = total_rows;
+	m_total_cols = total_cols;
+}
+
+void BattleMatrix::compute_row(unsigned i, unsigned col_first, unsigned col_last, double *out) const
+{
+	const auto &row_pkm = m_row_pkm[i];
+	for (unsigned j = col_first; j < col_last; ++j)
 	{
-		for (unsigned i = row_first; i < row_last; ++i)
+		if (m_progress != nullptr && m_progress->is_cancelled())
+		{
+			out[j] = std::numeric_limits<double>::quiet_NaN();
+			continue;
+		}
+		const auto &col_pkm = m_col_pkm[j];
+		if (m_seed >= 0)
+		{
+			seed_random(m_seed ^ m_row_hash[i] ^ (m_col_hash[j] * 0x9e3779b97f4a7c15ULL));
+		}
+		if (m_average_by_shield)
+		{
+			double score_0_0 = get_battle_score(row_pkm, col_pkm, 0, 0);
+			double score_0_1 = get_battle_score(row_pkm, col_pkm, 0, 1);
+			double score_1_1 = get_battle_score(row_pkm, col_pkm, 1, 0);
+			double score_1_0 = get_battle_score(row_pkm, col_pkm, 1, 1);
+			double score_2_2 = get_battle_score(row_pkm, col_pkm, 2, 2);
+			out[j] = (score_0_0 + score_0_1 + score_1_1 + score_1_0 + score_2_2) / 5;
+		}
+		else
+		{
+			out[j] = get_battle_score(row_pkm, col_pkm, row_pkm.num_shields_max, col_pkm.num_shields_max);
+		}
+		if (m_progress != nullptr)
 		{
-			for (unsigned j = col_first; j < col_last; ++j)
-			{
-				double score_0_0 = get_battle_score(row_pkm[i], col_pkm[j], 0, 0);
-				double score_0_1 = get_battle_score(row_pkm[i], col_pkm[j], 0, 1);
-				double score_1_1 = get_battle_score(row_pkm[i], col_pkm[j], 1, 0);
-				double score_1_0 = get_battle_score(row_pkm[i], col_pkm[j], 1, 1);
-				double score_2_2 = get_battle_score(row_pkm[i], col_pkm[j], 2, 2);
-				matrix[i][j] = (score_0_0 + score_0_1 + score_1_1 + score_1_0 + score_2_2) / 5;
-			}
+			m_progress->add_done();
 		}
 	}
-	else
+}
+
+void BattleMatrix::scatter_row(unsigned unique_row, const double *unique_values, double *buf)
+{
+	unsigned col_size = m_col_index.size();
+	for (auto i : m_row_members[unique_row])
 	{
-		for (unsigned i = row_first; i < row_last; ++i)
+		double *out = m_writer != nullptr ? buf : m_matrix[i].data();
+		for (unsigned j = 0; j < col_size; ++j)
 		{
-			for (unsigned j = col_first; j < col_last; ++j)
-			{
-				matrix[i][j] = get_battle_score(row_pkm[i], col_pkm[j], row_pkm[i].num_shields_max, col_pkm[j].num_shields_max);
-			}
+			out[j] = unique_values[m_col_index[j]];
 		}
+		if (m_writer != nullptr)
+		{
+			m_writer->write_row(i, buf);
+		}
+	}
+}
+
+/**
+ * Add the counters of the calling worker thread to the run's.
+ */
+void BattleMatrix::merge_perf()
+{
+	std::lock_guard<std::mutex> lock(m_perf_mutex);
+	m_perf.merge(PerfCounters::local());
+}
+
+void BattleMatrix::run_rows(std::atomic<unsigned> &next_row)
+{
+	GameMasterScope gm_scope(m_game_master);
+	GBS_PERF_COUNT(PerfCounters::local() = PerfCounters());
+	unsigned row_size = m_row_pkm.size(), col_size = m_col_pkm.size();
+	std::vector<double> unique_row(col_size);
+	std::vector<double> row_buf(m_writer != nullptr ? m_col_index.size() : 0);
+	for (unsigned i = next_row++; i < row_size; i = next_row++)
+	{
+		TraceSpan span(m_trace, "matrix row", i);
+		compute_row(i, 0, col_size, unique_row.data());
+		scatter_row(i, unique_row.data(), row_buf.data());
+	}
+	GBS_PERF_COUNT(merge_perf());
+}
+
+void BattleMatrix::run_cols(unsigned col_first, unsigned col_last)
+{
+	GameMasterScope gm_scope(m_game_master);
+	GBS_PERF_COUNT(PerfCounters::local() = PerfCounters());
+	TraceSpan span(m_trace, "matrix columns", col_first);
+	for (unsigned i = 0; i < m_row_pkm.size(); ++i)
+	{
+		compute_row(i, col_first, col_last, m_unique_matrix[i].data());
+	}
+	GBS_PERF_COUNT(merge_perf());
+}
+
+void BattleMatrix::prepare_output()
+{
+	m_game_master = &GameMaster::current();
+	m_perf = PerfCounters();
+	if (m_progress != nullptr)
+	{
+		m_progress->reset(static_cast<uint64_t>(m_row_pkm.size()) * m_col_pkm.size());
+	}
+	if (m_writer != nullptr)
+	{
+		MatrixFileHeader header;
+		header.num_rows = m_row_index.size();
+		header.num_cols = m_col_index.size();
+		header.row_offset = m_row_offset;
+		header.col_offset = m_col_offset;
+		header.total_rows = m_total_rows;
+		header.total_cols = m_total_cols;
+		m_writer->open(header);
+		m_matrix.clear();
+	}
+	else
+	{
+		m_matrix.assign(m_row_index.size(), std::vector<double>(m_col_index.size()));
 	}
 }
 
@@ -85,52 +286,53 @@ void worker(Matrix_t &matrix,
 
 void BattleMatrix::run()
 {
-	auto cpu_count = std::thread::hardware_concurrency();
+	unsigned row_size = m_row_pkm.size(), col_size = m_col_pkm.size();
+	unsigned cpu_count = std::thread::hardware_concurrency();
+	cpu_count = cpu_count > 0 ? cpu_count : 1;
 	std::vector<std::thread> threads(cpu_count);
 
-	// Round-Robin distribute jobs
-	unsigned total_job_count = 0;
-	unsigned row_size = m_row_pkm.size(), col_size = m_col_pkm.size();
-	if (row_size >= col_size)
+	prepare_output();
+
+	if (row_size >= cpu_count)
 	{
-		// Divide in row
+		// Hand out one row at a time, so that a streaming run only holds one row per thread
+		std::atomic<unsigned> next_row(0);
 		for (unsigned i = 0; i < cpu_count; ++i)
 		{
-			unsigned cur_job_count = (row_size / cpu_count) + ((row_size % cpu_count > i) ? 1 : 0);
-			threads[i] = std::thread(worker,
-									 std::ref(m_matrix),
-									 std::ref(m_row_pkm),
-									 std::ref(m_col_pkm),
-									 total_job_count,
-									 total_job_count + cur_job_count,
-									 (unsigned)0,
-									 col_size,
-									 m_average_by_shield);
-			total_job_count += cur_job_count;
+			threads[i] = std::thread(&BattleMatrix::run_rows, this, std::ref(next_row));
+		}
+		for (unsigned i = 0; i < cpu_count; ++i)
+		{
+			threads[i].join();
 		}
 	}
 	else
 	{
-		// Divide in column
+		// Too few rows to keep every thread busy, divide in column.
+		// The unique matrix is smaller than one row per thread here.
+		m_unique_matrix.assign(row_size, std::vector<double>(col_size));
+		unsigned total_job_count = 0;
 		for (unsigned i = 0; i < cpu_count; ++i)
 		{
-			unsigned cur_job_count = (row_size / cpu_count) + ((col_size % cpu_count > i) ? 1 : 0);
-			threads[i] = std::thread(worker,
-									 std::ref(m_matrix),
-									 std::ref(m_row_pkm),
-									 std::ref(m_col_pkm),
-									 (unsigned)0,
-									 row_size,
-									 total_job_count,
-									 total_job_count + cur_job_count,
-									 m_average_by_shield);
+			unsigned cur_job_count = (col_size / cpu_count) + ((col_size % cpu_count > i) ? 1 : 0);
+			threads[i] = std::thread(&BattleMatrix::run_cols, this, total_job_count, total_job_count + cur_job_count);
 			total_job_count += cur_job_count;
 		}
+		for (unsigned i = 0; i < cpu_count; ++i)
+		{
+			threads[i].join();
+		}
+		std::vector<double> row_buf(m_writer != nullptr ? m_col_index.size() : 0);
+		for (unsigned i = 0; i < row_size; ++i)
+		{
+			scatter_row(i, m_unique_matrix[i].data(), row_buf.data());
+		}
+		m_unique_matrix.clear();
 	}
 
-	for (unsigned i = 0; i < cpu_count; ++i)
+	if (m_writer != nullptr)
 	{
-		threads[i].join();
+		m_writer->close();
 	}
 }
 
@@ -138,14 +340,15 @@ void BattleMatrix::run()
 
 void BattleMatrix::run()
 {
-	worker(m_matrix,
-		   m_row_pkm,
-		   m_col_pkm,
-		   0,
-		   m_row_pkm.size(),
-		   0,
-		   m_col_pkm.size(),
-		   m_average_by_shield);
+	prepare_output();
+
+	std::atomic<unsigned> next_row(0);
+	run_rows(next_row);
+
+	if (m_writer != nullptr)
+	{
+		m_writer->close();
+	}
 }
 
 #endif
@@ -155,4 +358,9 @@ const Matrix_t &BattleMatrix::get() const
 	return m_matrix;
 }
 
+const PerfCounters &BattleMatrix::perf() const
+{
+	return m_perf;
+}
+
 } // namespace GoBattleSim
@@ -7,15 +7,28 @@
 
 namespace GoBattleSim
 {
-char err_msg[256];
+thread_local char err_msg[256];
 
 GameMaster GameMaster::instance;
+thread_local const GameMaster *GameMaster::bound = nullptr;
 
 GameMaster &GameMaster::get()
 {
 	return instance;
 }
 
+const GameMaster &GameMaster::current()
+{
+	return bound != nullptr ? *bound : instance;
+}
+
+const GameMaster *GameMaster::bind(const GameMaster *gm)
+{
+	auto prev = bound;
+	bound = gm;
+	return prev;
+}
+
 GameMaster::GameMaster()
 {
 	for (unsigned i = 0; i < MAX_NUM_STAGES; ++i)
@@ -31,6 +44,10 @@ GameMaster::GameMaster()
 		}
 		m_type_boosted_weathers[i] = -1;
 	}
+	for (int i = -1; i < static_cast<int>(MAX_NUM_TYPES); ++i)
+	{
+		update_dual_effectiveness(i);
+	}
 }
 
 unsigned GameMaster::num_types(unsigned t_num_types)
@@ -40,7 +57,12 @@ unsigned GameMaster::num_types(unsigned t_num_types)
 		sprintf(err_msg, "too many types (%d, max %d)", t_num_types, MAX_NUM_TYPES);
 		throw std::runtime_error(err_msg);
 	}
-	return m_num_types = t_num_types;
+	m_num_types = t_num_types;
+	for (int i = -1; i < static_cast<int>(MAX_NUM_TYPES); ++i)
+	{
+		update_dual_effectiveness(i);
+	}
+	return m_num_types;
 }
 
 double GameMaster::effectiveness(unsigned t_type_i, unsigned t_type_j, double t_multiplier)
@@ -48,6 +70,7 @@ double GameMaster::effectiveness(unsigned t_type_i, unsigned t_type_j, double t_
 	if (t_type_i < m_num_types && t_type_j < m_num_types)
 	{
 		m_type_effectiveness[t_type_i][t_type_j] = t_multiplier;
+		update_dual_effectiveness(t_type_i);
 	}
 	else if (t_type_i >= m_num_types)
 	{
@@ -80,6 +103,18 @@ double GameMaster::effectiveness(int t_type_i, int t_type_j) const
 	}
 }
 
+void GameMaster::update_dual_effectiveness(int t_move_type)
+{
+	auto row = m_dual_effectiveness[t_move_type + 1];
+	for (int i = -1; i < static_cast<int>(MAX_NUM_TYPES); ++i)
+	{
+		for (int j = -1; j < static_cast<int>(MAX_NUM_TYPES); ++j)
+		{
+			row[type_pair(i, j)] = effectiveness(t_move_type, i) * effectiveness(t_move_type, j);
+		}
+	}
+}
+
 int GameMaster::boosted_weather(unsigned t_type, int t_weather)
 {
 	if (0 <= t_type && t_type < m_num_types)
@@ -106,7 +141,7 @@ int GameMaster::boosted_weather(int t_type) const
 	}
 }
 
-void GameMaster::set_stage_bounds(int t_min_stage, int t_max_stage)
+static void validate_stage_bounds(int t_min_stage, int t_max_stage)
 {
 	if (t_min_stage > t_max_stage)
 	{
@@ -119,10 +154,20 @@ void GameMaster::set_stage_bounds(int t_min_stage, int t_max_stage)
 		sprintf(err_msg, "too many stages (%d, max %d)", num_stages, MAX_NUM_STAGES);
 		throw std::runtime_error(err_msg);
 	}
+}
+
+void GameMaster::set_stage_bounds(int t_min_stage, int t_max_stage)
+{
+	validate_stage_bounds(t_min_stage, t_max_stage);
 	min_stage = t_min_stage;
 	max_stage = t_max_stage;
 }
 
+void GameMaster::check_stage_bounds() const
+{
+	validate_stage_bounds(min_stage, max_stage);
+}
+
 double GameMaster::atk_stage_multiplier(int t_stage, double t_multiplier)
 {
 	if (min_stage <= t_stage && t_stage <= max_stage)
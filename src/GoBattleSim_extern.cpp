@@ -1,12 +1,28 @@
 
 #include "GoBattleSim_extern.h"
 #include "GoBattleSim.h"
+#include "ResultCache.h"
 #include "json_converter.hpp"
+#include "gm_snapshot.hpp"
 
 #include "config.h"
 
 #include <stdlib.h>
 
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
 using namespace GoBattleSim;
 
 class MessageCenter
@@ -17,28 +33,27 @@ public:
 		return instance;
 	}
 
-	void set_msg(const std::string &msg)
+	// msg may be binary, with null bytes in it. It is moved in, not copied.
+	void set_msg(std::string msg)
 	{
-		if (msg.size() >= m_msg_max_len)
-		{
-			delete[] m_msg;
-			m_msg_max_len = msg.size();
-			m_msg = new char[m_msg_max_len + 1];
-		}
-		strcpy(m_msg, msg.c_str());
+		m_msg = std::move(msg);
 	}
 
 	const char *get_msg() const
 	{
-		return m_msg;
+		return m_msg.c_str();
+	}
+
+	size_t get_msg_size() const
+	{
+		return m_msg.size();
 	}
 
 private:
 	MessageCenter() = default;
 	static MessageCenter instance;
 
-	char *m_msg{nullptr};
-	unsigned m_msg_max_len{0};
+	std::string m_msg;
 };
 
 MessageCenter MessageCenter::instance;
@@ -53,11 +68,134 @@ const char *GBS_error()
 	return err_msg;
 }
 
-void GBS_prepare(const char *input_j)
+/**
+ * A game master with the name mappings and catalog resolved from it.
+ * A config is never changed once it is built: GBS_config() and the snapshot loaders build a new one,
+ * and a simulation keeps the config it was prepared with until the next prepare.
+ * So configs are shared by contexts and threads without locks, and a running simulation never sees a change.
+ */
+struct GameMasterConfig
+{
+	GameMaster game_master;
+	PokeTypeMapping poketype_mapping;
+	WeatherMapping weather_mapping;
+	Catalog catalog;
+	// hash of the game master JSON, part of the cache key
+	std::string fingerprint;
+};
+
+typedef std::shared_ptr<const GameMasterConfig> ConfigPtr;
+
+/**
+ * A prepared input. A cached output stands in for run() and collect() of a seeded input.
+ */
+struct CachedRun
+{
+	// the config of prepare(), bound by run() and collect() too
+	ConfigPtr config;
+	// the moves the Pokemon of the input point to; null if no input is prepared,
+	// as the app may then hold Pokemon of a failed prepare whose moves are gone
+	std::shared_ptr<MovePool> moves;
+
+	// empty if the input is not cached
+	std::string key;
+	bool hit{false};
+	nlohmann::json output;
+
+	// wall time of the phases, reported under "perf" if the input has "perf": true
+	bool perf{false};
+	double prepare_ms{0};
+	double run_ms{0};
+};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Config of the last GBS_config(), only accessed with std::atomic_load() and std::atomic_store().
+ */
+static ConfigPtr global_config = std::make_shared<GameMasterConfig>();
+static CachedRun global_cached_run;
+
+static ConfigPtr get_global_config()
+{
+	return std::atomic_load(&global_config);
+}
+
+static void set_global_config(ConfigPtr config)
+{
+	std::atomic_store(&global_config, std::move(config));
+}
+
+/**
+ * Everything a simulation needs; the legacy API uses the global ones instead.
+ */
+struct GBS_Context
+{
+	GoBattleSimApp app;
+	ConfigPtr config;
+	CachedRun cached_run;
+	std::string output;
+	std::string error;
+	// buffers handed out by GBS_collect_buffer_ctx(), by data pointer
+	std::unordered_map<const void *, std::unique_ptr<std::string>> buffers;
+
+	// state of the GBS_run_async() job
+	std::mutex async_mutex;
+	std::condition_variable async_done;
+	bool async_running{false};
+	int async_status{0};
+#ifndef __EMSCRIPTEN__
+	std::thread::id async_thread;
+#endif
+};
+
+/**
+ * Bind the game master and name mappings of @param config (NULL for the global ones) to the calling thread
+ * until the end of the scope. They are only changed through the binding while the config is being built.
+ */
+class ContextScope
+{
+public:
+	ContextScope(const GameMaster *gm, PokeTypeMapping *poketype_mapping, WeatherMapping *weather_mapping, Catalog *catalog)
+		: m_gm_scope(gm),
+		  m_prev_poketype(PokeTypeMapping::bind(poketype_mapping)),
+		  m_prev_weather(WeatherMapping::bind(weather_mapping)),
+		  m_prev_catalog(Catalog::bind(catalog))
+	{
+	}
+
+	explicit ContextScope(GameMasterConfig *config)
+		: ContextScope(config != nullptr ? &config->game_master : nullptr,
+					   config != nullptr ? &config->poketype_mapping : nullptr,
+					   config != nullptr ? &config->weather_mapping : nullptr,
+					   config != nullptr ? &config->catalog : nullptr)
+	{
+	}
+
+	explicit ContextScope(const GameMasterConfig *config) : ContextScope(const_cast<GameMasterConfig *>(config))
+	{
+	}
+
+	~ContextScope()
+	{
+		PokeTypeMapping::bind(m_prev_poketype);
+		WeatherMapping::bind(m_prev_weather);
+		Catalog::bind(m_prev_catalog);
+	}
+
+private:
+	GameMasterScope m_gm_scope;
+	PokeTypeMapping *m_prev_poketype;
+	WeatherMapping *m_prev_weather;
+	Catalog *m_prev_catalog;
+};
+
+static void prepare_app(GoBattleSimApp &app, const nlohmann::json &j)
 {
-	auto j = nlohmann::json::parse(input_j);
 	auto mode = j.at("battleMode").get<BattleMode>();
-	auto &app = GoBattleSimApp::get();
 
 	if (mode == BattleMode::PvE)
 	{
@@ -81,9 +219,157 @@ void GBS_prepare(const char *input_j)
 	}
 }
 
+/**
+ * Prepare @param app with @param config, and look for its output in the result cache.
+ * Only seeded inputs are cached, and not the ones writing an output or trace file.
+ */
+static void prepare_cached(GoBattleSimApp &app, CachedRun &cached, const nlohmann::json &j, const ConfigPtr &config)
+{
+	auto start = std::chrono::steady_clock::now();
+	// the app holds the Pokemon of the previous input until they are replaced
+	auto prev_moves = std::move(cached.moves);
+	cached = CachedRun();
+	cached.config = config;
+	ContextScope scope(config.get());
+	auto perf = j.find("perf");
+	cached.perf = perf != j.end() && perf->get<bool>();
+	// moves of client input are interned per input, so that a long-running server does not pile them up
+	auto moves = std::make_shared<MovePool>();
+	{
+		MovePoolScope moves_scope(moves.get());
+		prepare_app(app, j);
+	}
+	cached.moves = std::move(moves);
+	cached.prepare_ms = elapsed_ms(start);
+	auto &trace = app.trace();
+	if (trace.enabled())
+	{
+		trace.set_origin(start);
+		trace.add_span("GBS_prepare", "engine", 0, trace.thread_track(), 0, cached.prepare_ms * 1000);
+	}
+
+	auto &cache = ResultCache::get();
+	auto seed = j.find("seed");
+	if (!cache.enabled() || seed == j.end() || !seed->is_number_integer() || seed->get<int64_t>() < 0 || j.contains("outputFile") || j.contains("traceFile"))
+	{
+		return;
+	}
+	// the parsed input dumps the same for inputs that only differ in key order or white space;
+	// the version keeps a cache directory from serving outputs of another build of the engine
+	cached.key = hash_key(j.dump() + '\n' + config->fingerprint + '\n' + PROJECT_GIT_VERSION);
+	std::string value;
+	if (cache.find(cached.key, value))
+	{
+		try
+		{
+			cached.output = nlohmann::json::from_cbor(value);
+			cached.hit = true;
+		}
+		catch (const nlohmann::json::exception &)
+		{
+			// a truncated or foreign file in the directory; the input is run again and the entry replaced
+			cache.discard(cached.key);
+		}
+	}
+}
+
+static void check_prepared(const CachedRun &cached)
+{
+	if (cached.moves == nullptr)
+	{
+		sprintf(err_msg, "no input prepared");
+		throw std::runtime_error(err_msg);
+	}
+}
+
+static void run_cached(GoBattleSimApp &app, CachedRun &cached)
+{
+	check_prepared(cached);
+	if (!cached.hit)
+	{
+		ContextScope scope(cached.config.get());
+		auto start = std::chrono::steady_clock::now();
+		app.run();
+		cached.run_ms = elapsed_ms(start);
+	}
+}
+
+static nlohmann::json decode(const void *data, size_t size, int encoding)
+{
+	auto first = static_cast<const uint8_t *>(data), last = first + size;
+	switch (encoding)
+	{
+	case GBS_ENCODING_JSON:
+	case GBS_ENCODING_JSON_COMPACT:
+		return nlohmann::json::parse(first, last);
+	case GBS_ENCODING_CBOR:
+		return nlohmann::json::from_cbor(first, last);
+	case GBS_ENCODING_MSGPACK:
+		return nlohmann::json::from_msgpack(first, last);
+	default:
+		sprintf(err_msg, "unknown encoding: %d", encoding);
+		throw std::runtime_error(err_msg);
+	}
+}
+
+static std::string encode(const nlohmann::json &j, int encoding)
+{
+	std::string out;
+	switch (encoding)
+	{
+	case GBS_ENCODING_JSON:
+		return j.dump(4);
+	case GBS_ENCODING_JSON_COMPACT:
+		return j.dump();
+	case GBS_ENCODING_CBOR:
+		nlohmann::json::to_cbor(j, out);
+		return out;
+	case GBS_ENCODING_MSGPACK:
+		nlohmann::json::to_msgpack(j, out);
+		return out;
+	default:
+		sprintf(err_msg, "unknown encoding: %d", encoding);
+		throw std::runtime_error(err_msg);
+	}
+}
+
+void GBS_prepare(const char *input_j)
+{
+	prepare_cached(GoBattleSimApp::get(), global_cached_run, nlohmann::json::parse(input_j), get_global_config());
+}
+
+void GBS_prepare_encoded(const void *input, size_t input_size, int encoding)
+{
+	prepare_cached(GoBattleSimApp::get(), global_cached_run, decode(input, input_size, encoding), get_global_config());
+}
+
 void GBS_run()
 {
-	GoBattleSimApp::get().run();
+	run_cached(GoBattleSimApp::get(), global_cached_run);
+}
+
+static void get_progress(const GoBattleSimApp &app, unsigned long long *num_done, unsigned long long *num_total)
+{
+	uint64_t done, total;
+	app.progress(done, total);
+	if (num_done != nullptr)
+	{
+		*num_done = done;
+	}
+	if (num_total != nullptr)
+	{
+		*num_total = total;
+	}
+}
+
+void GBS_progress(unsigned long long *num_done, unsigned long long *num_total)
+{
+	get_progress(GoBattleSimApp::get(), num_done, num_total);
+}
+
+void GBS_cancel()
+{
+	GoBattleSimApp::get().cancel();
 }
 
 template <class Output_t>
@@ -94,9 +380,8 @@ void collect_and_set(GoBattleSimApp &app, nlohmann::json &j)
 	j = output;
 }
 
-const char *GBS_collect()
+static nlohmann::json collect_app(GoBattleSimApp &app)
 {
-	auto &app = GoBattleSimApp::get();
 	nlohmann::json j;
 
 	if (app.battle_mode == BattleMode::PvE)
@@ -123,7 +408,22 @@ const char *GBS_collect()
 	}
 	else if (app.battle_mode == BattleMode::BattleMatrix)
 	{
-		collect_and_set<Matrix_t>(app, j);
+		if (app.matrix_file_format != MatrixFileFormat::None)
+		{
+			collect_and_set<BattleMatrixFileOutput>(app, j);
+		}
+		else if (app.team_search)
+		{
+			nlohmann::json matrix_j, teams_j;
+			collect_and_set<Matrix_t>(app, matrix_j);
+			collect_and_set<std::vector<TeamScore>>(app, teams_j);
+			j["matrix"] = std::move(matrix_j);
+			j["teams"] = std::move(teams_j);
+		}
+		else
+		{
+			collect_and_set<Matrix_t>(app, j);
+		}
 	}
 	else
 	{
@@ -131,18 +431,585 @@ const char *GBS_collect()
 		throw std::runtime_error(err_msg);
 	}
 
-	auto j_str = j.dump(4);
-	MessageCenter::get().set_msg(j_str);
+	return j;
+}
+
+/**
+ * Collect the output of @param app, or the cached one. A complete output is stored in the cache.
+ */
+static nlohmann::json collect_cached(GoBattleSimApp &app, CachedRun &cached)
+{
+	check_prepared(cached);
+	nlohmann::json j;
+	if (cached.hit)
+	{
+		j = cached.output;
+	}
+	else
+	{
+		ContextScope scope(cached.config.get());
+		j = collect_app(app);
+		uint64_t num_done, num_total;
+		app.progress(num_done, num_total);
+		// a cancelled run is not cached
+		if (!cached.key.empty() && num_done == num_total)
+		{
+			std::string value;
+			nlohmann::json::to_cbor(j, value);
+			ResultCache::get().insert(cached.key, value);
+			cached.key.clear();
+		}
+	}
+	return j;
+}
+
+/**
+ * @return the same bytes as {"output": ..., "perf": @param perf_j} in @param encoding,
+ * where @param output is the output already in that encoding.
+ */
+static std::string wrap_output(const std::string &output, const nlohmann::json &perf_j, int encoding)
+{
+	std::string wrapped;
+	switch (encoding)
+	{
+	case GBS_ENCODING_JSON:
+		// line breaks in strings are escaped, so every raw one starts a line to be indented
+		wrapped = "{\n    \"output\": ";
+		for (char c : output)
+		{
+			wrapped += c;
+			if (c == '\n')
+			{
+				wrapped += "    ";
+			}
+		}
+		wrapped += ",\n    \"perf\": ";
+		for (char c : perf_j.dump(4))
+		{
+			wrapped += c;
+			if (c == '\n')
+			{
+				wrapped += "    ";
+			}
+		}
+		wrapped += "\n}";
+		return wrapped;
+	case GBS_ENCODING_JSON_COMPACT:
+		return "{\"output\":" + output + ",\"perf\":" + perf_j.dump() + "}";
+	case GBS_ENCODING_CBOR:
+		// a map of 2, then text keys of 6 and 4 bytes
+		wrapped = "\xa2\x66output" + output + "\x64perf";
+		nlohmann::json::to_cbor(perf_j, wrapped);
+		return wrapped;
+	case GBS_ENCODING_MSGPACK:
+		wrapped = "\x82\xa6output" + output + "\xa4perf";
+		nlohmann::json::to_msgpack(perf_j, wrapped);
+		return wrapped;
+	default:
+		sprintf(err_msg, "unknown encoding: %d", encoding);
+		throw std::runtime_error(err_msg);
+	}
+}
+
+/**
+ * Collect the output of @param app like collect_cached(), in @param encoding.
+ */
+static std::string collect_encoded(GoBattleSimApp &app, CachedRun &cached, int encoding)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto j = collect_cached(app, cached);
+	double build_ms = elapsed_ms(start);
+	start = std::chrono::steady_clock::now();
+	auto output = encode(j, encoding);
+	if (!cached.perf)
+	{
+		return output;
+	}
+
+	// the encoded output is wrapped as it is, so that "perf" has the time spent encoding it
+	nlohmann::json perf_j;
+#ifdef GBS_PERF_COUNTERS
+	if (!cached.hit)
+	{
+		perf_j = app.perf();
+	}
+#endif
+	perf_j["cached"] = cached.hit;
+	perf_j["prepareMs"] = cached.prepare_ms;
+	perf_j["runMs"] = cached.run_ms;
+	perf_j["buildOutputMs"] = build_ms;
+	perf_j["encodeMs"] = elapsed_ms(start);
+	return wrap_output(output, perf_j, encoding);
+}
+
+const char *GBS_collect()
+{
+	MessageCenter::get().set_msg(collect_encoded(GoBattleSimApp::get(), global_cached_run, GBS_ENCODING_JSON));
+	return MessageCenter::get().get_msg();
+}
+
+const void *GBS_collect_encoded(int encoding, size_t *output_size)
+{
+	MessageCenter::get().set_msg(collect_encoded(GoBattleSimApp::get(), global_cached_run, encoding));
+	if (output_size != nullptr)
+	{
+		*output_size = MessageCenter::get().get_msg_size();
+	}
 	return MessageCenter::get().get_msg();
 }
 
+/**
+ * Build a new config from the game master @param gm_j.
+ */
+static ConfigPtr build_config(const char *gm_j)
+{
+	auto gm_json = nlohmann::json::parse(gm_j);
+	auto config = std::make_shared<GameMasterConfig>();
+	ContextScope scope(config.get());
+	config->game_master = gm_json;
+	config->fingerprint = hash_key(gm_json.dump());
+	return config;
+}
+
+/**
+ * Build a new config from the snapshot file at @param path.
+ */
+static ConfigPtr load_config(const char *path)
+{
+	auto config = std::make_shared<GameMasterConfig>();
+	load_snapshot(path, config->game_master, config->poketype_mapping, config->weather_mapping, config->catalog, config->fingerprint);
+	return config;
+}
+
+/**
+ * @return the game master of @param config in JSON
+ */
+static std::string dump_config(const ConfigPtr &config)
+{
+	ContextScope scope(config.get());
+	return nlohmann::json(config->game_master).dump(4);
+}
+
 const char *GBS_config(const char *gm_j)
 {
+	auto config = gm_j != nullptr ? build_config(gm_j) : get_global_config();
 	if (gm_j != nullptr)
 	{
-		GameMaster::get() = nlohmann::json::parse(gm_j);
+		set_global_config(config);
 	}
-	auto j_str = nlohmann::json(GameMaster::get()).dump(4);
-	MessageCenter::get().set_msg(j_str);
+	MessageCenter::get().set_msg(dump_config(config));
 	return MessageCenter::get().get_msg();
 }
+
+void GBS_compile_snapshot(const char *gm_j, const char *path)
+{
+	// a new config, so that the one in use is not changed
+	auto config = gm_j != nullptr ? build_config(gm_j) : std::make_shared<GameMasterConfig>();
+	write_snapshot(path, config->game_master, config->poketype_mapping, config->weather_mapping, config->catalog, config->fingerprint);
+}
+
+void GBS_load_snapshot(const char *path)
+{
+	set_global_config(load_config(path));
+}
+
+/**
+ * Split a batch into its inputs. A batch is either a JSON array, or JSON Lines (one input per line).
+ *
+ * @return whether the batch is a JSON array
+ */
+static bool parse_batch(const char *inputs_j, std::vector<nlohmann::json> &inputs)
+{
+	const char *first = inputs_j;
+	while (isspace(*first))
+	{
+		++first;
+	}
+	if (*first == '[')
+	{
+		nlohmann::json::parse(first).get_to(inputs);
+		return true;
+	}
+	std::istringstream iss(first);
+	std::string line;
+	while (std::getline(iss, line))
+	{
+		if (line.find_first_not_of(" \t\r") != std::string::npos)
+		{
+			inputs.push_back(nlohmann::json::parse(line));
+		}
+	}
+	return false;
+}
+
+/**
+ * Run the inputs from @param next_input on with @param config, with one app reused for all of them.
+ * A failed input gets {"error": message} as its output.
+ */
+static void run_batch_worker(const std::vector<nlohmann::json> &inputs,
+							 std::vector<std::string> &outputs,
+							 std::atomic<size_t> &next_input,
+							 const ConfigPtr &config)
+{
+	GoBattleSimApp app;
+	CachedRun cached;
+	for (size_t i = next_input++; i < inputs.size(); i = next_input++)
+	{
+		try
+		{
+			prepare_cached(app, cached, inputs[i], config);
+			run_cached(app, cached);
+			outputs[i] = collect_encoded(app, cached, GBS_ENCODING_JSON_COMPACT);
+		}
+		catch (const std::exception &e)
+		{
+			outputs[i] = nlohmann::json{{"error", e.what()}}.dump();
+		}
+	}
+}
+
+/**
+ * Run every input of @param inputs_j across threads, all with @param config.
+ * Outputs are in input order, as a compact JSON array or JSON Lines like the input.
+ */
+static std::string run_batch(const char *inputs_j, const ConfigPtr &config)
+{
+	std::vector<nlohmann::json> inputs;
+	bool is_array = parse_batch(inputs_j, inputs);
+	// outputs are encoded by the workers, and only joined here
+	std::vector<std::string> outputs(inputs.size());
+	std::atomic<size_t> next_input(0);
+
+#ifndef __EMSCRIPTEN__
+	unsigned cpu_count = std::thread::hardware_concurrency();
+	cpu_count = cpu_count > 0 ? cpu_count : 1;
+	cpu_count = std::min<size_t>(cpu_count, std::max<size_t>(inputs.size(), 1));
+	std::vector<std::thread> threads(cpu_count);
+	for (unsigned i = 0; i < cpu_count; ++i)
+	{
+		threads[i] = std::thread(run_batch_worker, std::cref(inputs), std::ref(outputs), std::ref(next_input), std::cref(config));
+	}
+	for (unsigned i = 0; i < cpu_count; ++i)
+	{
+		threads[i].join();
+	}
+#else
+	run_batch_worker(inputs, outputs, next_input, config);
+#endif
+
+	if (is_array)
+	{
+		std::string output = "[";
+		for (size_t i = 0; i < outputs.size(); ++i)
+		{
+			if (i > 0)
+			{
+				output += ',';
+			}
+			output += outputs[i];
+		}
+		return output + "]";
+	}
+	std::string output;
+	for (const auto &output_i : outputs)
+	{
+		output += output_i;
+		output += '\n';
+	}
+	return output;
+}
+
+const char *GBS_batch(const char *inputs_j)
+{
+	MessageCenter::get().set_msg(run_batch(inputs_j, get_global_config()));
+	return MessageCenter::get().get_msg();
+}
+
+GBS_Context *GBS_create_context()
+{
+	auto ctx = new GBS_Context;
+	// start from the global config, so that a process can load the game master once
+	ctx->config = get_global_config();
+	return ctx;
+}
+
+void GBS_destroy_context(GBS_Context *ctx)
+{
+	GBS_wait(ctx);
+	delete ctx;
+}
+
+const char *GBS_error_ctx(GBS_Context *ctx)
+{
+	return ctx->error.c_str();
+}
+
+/**
+ * Run @param func, and keep any error in the context instead of throwing it.
+ */
+template <class Func>
+static int call_with_context(GBS_Context *ctx, Func func)
+{
+	try
+	{
+		func();
+		ctx->error.clear();
+		return 0;
+	}
+	catch (const std::exception &e)
+	{
+		ctx->error = e.what();
+		return -1;
+	}
+}
+
+int GBS_prepare_ctx(GBS_Context *ctx, const char *input_j)
+{
+	return call_with_context(ctx, [&]() {
+		prepare_cached(ctx->app, ctx->cached_run, nlohmann::json::parse(input_j), ctx->config);
+	});
+}
+
+int GBS_prepare_encoded_ctx(GBS_Context *ctx, const void *input, size_t input_size, int encoding)
+{
+	return call_with_context(ctx, [&]() {
+		prepare_cached(ctx->app, ctx->cached_run, decode(input, input_size, encoding), ctx->config);
+	});
+}
+
+int GBS_run_ctx(GBS_Context *ctx)
+{
+	return call_with_context(ctx, [&]() {
+		run_cached(ctx->app, ctx->cached_run);
+	});
+}
+
+const char *GBS_collect_ctx(GBS_Context *ctx)
+{
+	int status = call_with_context(ctx, [&]() {
+		ctx->output = collect_encoded(ctx->app, ctx->cached_run, GBS_ENCODING_JSON);
+	});
+	return status == 0 ? ctx->output.c_str() : nullptr;
+}
+
+const void *GBS_collect_encoded_ctx(GBS_Context *ctx, int encoding, size_t *output_size)
+{
+	int status = call_with_context(ctx, [&]() {
+		ctx->output = collect_encoded(ctx->app, ctx->cached_run, encoding);
+	});
+	if (output_size != nullptr)
+	{
+		*output_size = status == 0 ? ctx->output.size() : 0;
+	}
+	return status == 0 ? ctx->output.data() : nullptr;
+}
+
+const void *GBS_collect_buffer_ctx(GBS_Context *ctx, int encoding, size_t *output_size)
+{
+	const void *data = nullptr;
+	std::unique_ptr<std::string> buffer;
+	int status = call_with_context(ctx, [&]() {
+		// the output is serialized into the string that becomes the buffer, and never copied
+		buffer.reset(new std::string(collect_encoded(ctx->app, ctx->cached_run, encoding)));
+		data = buffer->data();
+		ctx->buffers[data] = std::move(buffer);
+	});
+	if (output_size != nullptr)
+	{
+		*output_size = status == 0 ? ctx->buffers[data]->size() : 0;
+	}
+	return data;
+}
+
+int GBS_free_buffer_ctx(GBS_Context *ctx, const void *buffer)
+{
+	return ctx->buffers.erase(buffer) > 0 ? 0 : -1;
+}
+
+const char *GBS_config_ctx(GBS_Context *ctx, const char *gm_j)
+{
+	int status = call_with_context(ctx, [&]() {
+		if (gm_j != nullptr)
+		{
+			ctx->config = build_config(gm_j);
+		}
+		ctx->output = dump_config(ctx->config);
+	});
+	return status == 0 ? ctx->output.c_str() : nullptr;
+}
+
+int GBS_load_snapshot_ctx(GBS_Context *ctx, const char *path)
+{
+	return call_with_context(ctx, [&]() {
+		ctx->config = load_config(path);
+	});
+}
+
+const char *GBS_batch_ctx(GBS_Context *ctx, const char *inputs_j)
+{
+	int status = call_with_context(ctx, [&]() {
+		ctx->output = run_batch(inputs_j, ctx->config);
+	});
+	return status == 0 ? ctx->output.c_str() : nullptr;
+}
+
+void GBS_progress_ctx(GBS_Context *ctx, unsigned long long *num_done, unsigned long long *num_total)
+{
+	get_progress(ctx->app, num_done, num_total);
+}
+
+void GBS_cancel_ctx(GBS_Context *ctx)
+{
+	ctx->app.cancel();
+}
+
+void GBS_cache_config(size_t max_entries, const char *dir)
+{
+	ResultCache::get().configure(max_entries, dir != nullptr ? dir : "");
+}
+
+void GBS_cache_stats(unsigned long long *num_hits, unsigned long long *num_misses)
+{
+	if (num_hits != nullptr)
+	{
+		*num_hits = ResultCache::get().num_hits();
+	}
+	if (num_misses != nullptr)
+	{
+		*num_misses = ResultCache::get().num_misses();
+	}
+}
+
+#ifndef __EMSCRIPTEN__
+
+/**
+ * Threads running GBS_run_async() jobs, started on the first job.
+ */
+class JobPool
+{
+public:
+	static JobPool &get()
+	{
+		static JobPool instance;
+		return instance;
+	}
+
+	void submit(std::function<void()> job)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_threads.empty())
+		{
+			unsigned cpu_count = std::thread::hardware_concurrency();
+			cpu_count = cpu_count > 0 ? cpu_count : 1;
+			for (unsigned i = 0; i < cpu_count; ++i)
+			{
+				m_threads.emplace_back(&JobPool::work, this);
+			}
+		}
+		m_jobs.push_back(std::move(job));
+		m_cv.notify_one();
+	}
+
+	~JobPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopped = true;
+		}
+		m_cv.notify_all();
+		for (auto &thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+private:
+	JobPool() = default;
+
+	void work()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_cv.wait(lock, [this]() { return m_stopped || !m_jobs.empty(); });
+			if (m_jobs.empty())
+			{
+				return;
+			}
+			auto job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			lock.unlock();
+			job();
+			lock.lock();
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<std::function<void()>> m_jobs;
+	std::vector<std::thread> m_threads;
+	bool m_stopped{false};
+};
+
+#endif
+
+int GBS_run_async(GBS_Context *ctx, GBS_Callback callback, void *user_data)
+{
+	{
+		std::lock_guard<std::mutex> lock(ctx->async_mutex);
+		if (ctx->async_running)
+		{
+			// the running job owns the error message, so it is not set here
+			return -1;
+		}
+		ctx->async_running = true;
+	}
+	auto job = [ctx, callback, user_data]() {
+		int status = GBS_run_ctx(ctx);
+		{
+			std::lock_guard<std::mutex> lock(ctx->async_mutex);
+			ctx->async_status = status;
+#ifndef __EMSCRIPTEN__
+			ctx->async_thread = std::this_thread::get_id();
+#endif
+		}
+		if (callback != nullptr)
+		{
+			callback(ctx, status, user_data);
+		}
+		// once async_running is cleared, GBS_poll() may report the job done and the context may be
+		// destroyed, so nothing touches ctx after the lock is released
+		std::lock_guard<std::mutex> lock(ctx->async_mutex);
+		ctx->async_running = false;
+#ifndef __EMSCRIPTEN__
+		ctx->async_thread = std::thread::id();
+#endif
+		ctx->async_done.notify_all();
+	};
+#ifndef __EMSCRIPTEN__
+	JobPool::get().submit(job);
+#else
+	job();
+#endif
+	return 0;
+}
+
+int GBS_poll(GBS_Context *ctx)
+{
+	std::lock_guard<std::mutex> lock(ctx->async_mutex);
+	return ctx->async_running ? 0 : 1;
+}
+
+int GBS_wait(GBS_Context *ctx)
+{
+	std::unique_lock<std::mutex> lock(ctx->async_mutex);
+#ifndef __EMSCRIPTEN__
+	// called from the callback, whose job has finished running
+	if (ctx->async_running && ctx->async_thread == std::this_thread::get_id())
+	{
+		return ctx->async_status;
+	}
+#endif
+	ctx->async_done.wait(lock, [ctx]() { return !ctx->async_running; });
+	return ctx->async_status;
+}
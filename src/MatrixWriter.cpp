@@ -0,0 +1,375 @@
+// rows may be written past 2 GB, so the offset type of fseeko() must be 64 bits wide
+#define _FILE_OFFSET_BITS 64
+
+#include "MatrixWriter.h"
+
+#include "GameMaster.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+typedef __int64 file_offset_t;
+#else
+#include <sys/types.h>
+typedef off_t file_offset_t;
+#endif
+
+namespace GoBattleSim
+{
+
+static void put_le(unsigned char *out, uint64_t value, unsigned num_bytes)
+{
+	for (unsigned i = 0; i < num_bytes; ++i)
+	{
+		out[i] = static_cast<unsigned char>(value >> (8 * i));
+	}
+}
+
+static uint64_t get_le(const unsigned char *in, unsigned num_bytes)
+{
+	uint64_t value = 0;
+	for (unsigned i = 0; i < num_bytes; ++i)
+	{
+		value |= static_cast<uint64_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+MatrixFileFormat parse_matrix_file_format(std::string format_str)
+{
+	std::transform(format_str.begin(), format_str.end(), format_str.begin(), ::tolower);
+	if (format_str == "csv")
+	{
+		return MatrixFileFormat::CSV;
+	}
+	else if (format_str == "float64" || format_str == "f64")
+	{
+		return MatrixFileFormat::Float64;
+	}
+	else if (format_str == "float32" || format_str == "f32")
+	{
+		return MatrixFileFormat::Float32;
+	}
+	sprintf(err_msg, "unknown matrix output format: %s", format_str.c_str());
+	throw std::runtime_error(err_msg);
+}
+
+const char *matrix_file_format_name(MatrixFileFormat format)
+{
+	switch (format)
+	{
+	case MatrixFileFormat::CSV:
+		return "csv";
+	case MatrixFileFormat::Float64:
+		return "float64";
+	case MatrixFileFormat::Float32:
+		return "float32";
+	default:
+		return "none";
+	}
+}
+
+bool write_matrix_file_header(FILE *file, const MatrixFileHeader &header)
+{
+	unsigned char buf[MATRIX_FILE_HEADER_SIZE] = {};
+	memcpy(buf, MATRIX_FILE_MAGIC, 4);
+	put_le(buf + 4, header.version, 4);
+	put_le(buf + 8, header.element_size, 4);
+	put_le(buf + 12, header.num_rows, 4);
+	put_le(buf + 16, header.num_cols, 4);
+	put_le(buf + 20, header.row_offset, 4);
+	put_le(buf + 24, header.col_offset, 4);
+	put_le(buf + 28, header.total_rows, 4);
+	put_le(buf + 32, header.total_cols, 4);
+	return fwrite(buf, 1, MATRIX_FILE_HEADER_SIZE, file) == MATRIX_FILE_HEADER_SIZE;
+}
+
+bool read_matrix_file_header(FILE *file, MatrixFileHeader &header)
+{
+	unsigned char buf[MATRIX_FILE_HEADER_SIZE];
+	if (fread(buf, 1, MATRIX_FILE_HEADER_SIZE, file) != MATRIX_FILE_HEADER_SIZE || memcmp(buf, MATRIX_FILE_MAGIC, 4) != 0)
+	{
+		return false;
+	}
+	header.version = get_le(buf + 4, 4);
+	header.element_size = get_le(buf + 8, 4);
+	header.num_rows = get_le(buf + 12, 4);
+	header.num_cols = get_le(buf + 16, 4);
+	header.row_offset = get_le(buf + 20, 4);
+	header.col_offset = get_le(buf + 24, 4);
+	header.total_rows = get_le(buf + 28, 4);
+	header.total_cols = get_le(buf + 32, 4);
+	return header.element_size == 4 || header.element_size == 8;
+}
+
+void read_matrix_file(const std::string &path, MatrixFileHeader &header, std::vector<double> &values)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file == nullptr || !read_matrix_file_header(file, header))
+	{
+		if (file != nullptr)
+		{
+			fclose(file);
+		}
+		snprintf(err_msg, sizeof(err_msg), "bad matrix file: %s", path.c_str());
+		throw std::runtime_error(err_msg);
+	}
+	size_t count = static_cast<size_t>(header.num_rows) * header.num_cols;
+	std::vector<unsigned char> buf(count * header.element_size);
+	size_t num_read = fread(buf.data(), 1, buf.size(), file);
+	fclose(file);
+	if (num_read != buf.size())
+	{
+		snprintf(err_msg, sizeof(err_msg), "truncated matrix file: %s", path.c_str());
+		throw std::runtime_error(err_msg);
+	}
+	values.resize(count);
+	for (size_t k = 0; k < count; ++k)
+	{
+		if (header.element_size == 8)
+		{
+			uint64_t bits = get_le(buf.data() + k * 8, 8);
+			memcpy(&values[k], &bits, 8);
+		}
+		else
+		{
+			uint32_t bits = get_le(buf.data() + k * 4, 4);
+			float value;
+			memcpy(&value, &bits, 4);
+			values[k] = value;
+		}
+	}
+}
+
+static void check_tile(const std::string &path, const MatrixFileHeader &tile, const MatrixFileHeader &first)
+{
+	if (tile.total_rows != first.total_rows || tile.total_cols != first.total_cols ||
+		tile.row_offset + tile.num_rows > tile.total_rows || tile.col_offset + tile.num_cols > tile.total_cols)
+	{
+		snprintf(err_msg, sizeof(err_msg), "matrix tile does not fit: %s", path.c_str());
+		throw std::runtime_error(err_msg);
+	}
+}
+
+void merge_matrix_tiles(const std::vector<std::string> &paths, std::vector<std::vector<double>> &matrix)
+{
+	MatrixFileHeader first, tile;
+	std::vector<double> values;
+	for (size_t t = 0; t < paths.size(); ++t)
+	{
+		read_matrix_file(paths[t], tile, values);
+		if (t == 0)
+		{
+			first = tile;
+			matrix.assign(first.total_rows, std::vector<double>(first.total_cols));
+		}
+		check_tile(paths[t], tile, first);
+		for (unsigned i = 0; i < tile.num_rows; ++i)
+		{
+			std::copy(values.begin() + static_cast<size_t>(i) * tile.num_cols,
+					  values.begin() + static_cast<size_t>(i + 1) * tile.num_cols,
+					  matrix[tile.row_offset + i].begin() + tile.col_offset);
+		}
+	}
+}
+
+void merge_matrix_tiles(const std::vector<std::string> &paths, MatrixWriter &writer)
+{
+	MatrixFileHeader first, tile;
+	std::vector<double> values;
+	for (size_t t = 0; t < paths.size(); ++t)
+	{
+		read_matrix_file(paths[t], tile, values);
+		if (t == 0)
+		{
+			first = tile;
+			MatrixFileHeader header;
+			header.num_rows = header.total_rows = first.total_rows;
+			header.num_cols = header.total_cols = first.total_cols;
+			writer.open(header);
+		}
+		check_tile(paths[t], tile, first);
+		if (tile.col_offset != 0 || tile.num_cols != tile.total_cols)
+		{
+			snprintf(err_msg, sizeof(err_msg), "matrix tile does not cover full rows: %s", paths[t].c_str());
+			throw std::runtime_error(err_msg);
+		}
+		for (unsigned i = 0; i < tile.num_rows; ++i)
+		{
+			writer.write_row(tile.row_offset + i, values.data() + static_cast<size_t>(i) * tile.num_cols);
+		}
+	}
+	writer.close();
+}
+
+MatrixWriter::MatrixWriter(const std::string &path, MatrixFileFormat format)
+	: m_path(path), m_format(format)
+{
+	if (format == MatrixFileFormat::None)
+	{
+		sprintf(err_msg, "matrix file format must be specified");
+		throw std::runtime_error(err_msg);
+	}
+}
+
+MatrixWriter::~MatrixWriter()
+{
+	// a writer destroyed without close() has failed already, so errors are not thrown here
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+	}
+}
+
+void MatrixWriter::open(const MatrixFileHeader &header)
+{
+	close();
+	m_header = header;
+	m_header.element_size = m_format == MatrixFileFormat::Float32 ? 4 : 8;
+	m_pending_rows.clear();
+	m_next_row = 0;
+	m_error.clear();
+
+	m_file = fopen(m_path.c_str(), m_format == MatrixFileFormat::CSV ? "w" : "wb");
+	if (m_file == nullptr)
+	{
+		snprintf(err_msg, sizeof(err_msg), "cannot open matrix file: %s", m_path.c_str());
+		throw std::runtime_error(err_msg);
+	}
+	if (m_format != MatrixFileFormat::CSV && !write_matrix_file_header(m_file, m_header))
+	{
+		set_error();
+		close();
+	}
+}
+
+void MatrixWriter::write_row(unsigned row, const double *values)
+{
+	if (m_format == MatrixFileFormat::CSV)
+	{
+		write_csv_row(row, values);
+	}
+	else
+	{
+		write_binary_row(row, values);
+	}
+}
+
+void MatrixWriter::write_binary_row(unsigned row, const double *values)
+{
+	auto element_size = m_header.element_size;
+	std::vector<unsigned char> buf(m_header.num_cols * element_size);
+	for (unsigned j = 0; j < m_header.num_cols; ++j)
+	{
+		if (element_size == 8)
+		{
+			uint64_t bits;
+			memcpy(&bits, values + j, 8);
+			put_le(buf.data() + j * 8, bits, 8);
+		}
+		else
+		{
+			float value = static_cast<float>(values[j]);
+			uint32_t bits;
+			memcpy(&bits, &value, 4);
+			put_le(buf.data() + j * 4, bits, 4);
+		}
+	}
+
+	// rows have fixed size, so they can be written at their final position in any order
+	file_offset_t offset = MATRIX_FILE_HEADER_SIZE + static_cast<file_offset_t>(row) * buf.size();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_error.empty())
+	{
+		return;
+	}
+	if (fseeko(m_file, offset, SEEK_SET) != 0 || fwrite(buf.data(), 1, buf.size(), m_file) != buf.size())
+	{
+		set_error();
+	}
+}
+
+void MatrixWriter::write_csv_row(unsigned row, const double *values)
+{
+	std::string line;
+	char cell[32];
+	for (unsigned j = 0; j < m_header.num_cols; ++j)
+	{
+		snprintf(cell, sizeof(cell), j == 0 ? "%.17g" : ",%.17g", values[j]);
+		line += cell;
+	}
+	line += '\n';
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_error.empty())
+	{
+		return;
+	}
+	if (row != m_next_row)
+	{
+		m_pending_rows[row] = std::move(line);
+		return;
+	}
+	bool ok = fwrite(line.data(), 1, line.size(), m_file) == line.size();
+	++m_next_row;
+	for (auto it = m_pending_rows.begin(); ok && it != m_pending_rows.end() && it->first == m_next_row;)
+	{
+		ok = fwrite(it->second.data(), 1, it->second.size(), m_file) == it->second.size();
+		++m_next_row;
+		it = m_pending_rows.erase(it);
+	}
+	if (!ok)
+	{
+		set_error();
+	}
+}
+
+void MatrixWriter::set_error()
+{
+	if (m_error.empty())
+	{
+		m_error = strerror(errno);
+	}
+}
+
+void MatrixWriter::close()
+{
+	if (m_file != nullptr)
+	{
+		// buffered rows are only written out here, so a full disk may show up this late
+		if (fclose(m_file) != 0)
+		{
+			set_error();
+		}
+		m_file = nullptr;
+	}
+	if (!m_error.empty())
+	{
+		snprintf(err_msg, sizeof(err_msg), "cannot write matrix file %s: %s", m_path.c_str(), m_error.c_str());
+		m_error.clear();
+		throw std::runtime_error(err_msg);
+	}
+}
+
+const std::string &MatrixWriter::path() const
+{
+	return m_path;
+}
+
+MatrixFileFormat MatrixWriter::format() const
+{
+	return m_format;
+}
+
+const MatrixFileHeader &MatrixWriter::header() const
+{
+	return m_header;
+}
+
+} // namespace GoBattleSim
@@ -0,0 +1,81 @@
+#include "Move.h"
+
+#include <functional>
+
+namespace GoBattleSim
+{
+
+bool operator==(const Move &a, const Move &b)
+{
+	return a.poketype == b.poketype && a.power == b.power && a.energy == b.energy && a.duration == b.duration &&
+		   a.dws == b.dws && a.effect.activation_chance == b.effect.activation_chance &&
+		   a.effect.self_atk_delta == b.effect.self_atk_delta && a.effect.self_def_delta == b.effect.self_def_delta &&
+		   a.effect.target_atk_delta == b.effect.target_atk_delta && a.effect.target_def_delta == b.effect.target_def_delta;
+}
+
+size_t MoveHash::operator()(const Move &move) const
+{
+	size_t h = std::hash<double>()(move.effect.activation_chance);
+	for (int field : {move.poketype, move.power, move.energy, move.duration, move.dws,
+					  move.effect.self_atk_delta, move.effect.self_def_delta,
+					  move.effect.target_atk_delta, move.effect.target_def_delta})
+	{
+		h = h * 31 + std::hash<int>()(field);
+	}
+	return h;
+}
+
+thread_local MovePool *MovePool::bound = nullptr;
+
+static MovePool &process_pool()
+{
+	static MovePool pool;
+	return pool;
+}
+
+/**
+ * Moves are only interned when Pokemon are set up, never while battling, so one lock is enough.
+ */
+const Move *MovePool::intern(const Move &move)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_index.find(move);
+	if (it != m_index.end())
+	{
+		return it->second;
+	}
+	m_moves.push_back(move);
+	m_index.emplace(move, &m_moves.back());
+	return &m_moves.back();
+}
+
+size_t MovePool::size() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_moves.size();
+}
+
+MovePool &MovePool::get()
+{
+	return bound != nullptr ? *bound : process_pool();
+}
+
+MovePool *MovePool::bind(MovePool *pool)
+{
+	auto prev = bound;
+	bound = pool;
+	return prev;
+}
+
+const Move *intern_move(const Move &move)
+{
+	return MovePool::get().intern(move);
+}
+
+const Move *empty_move()
+{
+	static const Move *move = process_pool().intern(Move());
+	return move;
+}
+
+} // namespace GoBattleSim
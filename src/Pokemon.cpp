@@ -3,6 +3,8 @@
 
 #include "GameMaster.h"
 
+#include <algorithm>
+#include <math.h>
 #include <string.h>
 #include <stdexcept>
 #include <stdio.h>
@@ -15,64 +17,54 @@ int calc_damage(const Pokemon *attacker,
 				const Pokemon *defender,
 				double multiplier)
 {
-	if (move->poketype == attacker->poketype1 || move->poketype == attacker->poketype2)
-	{
-		multiplier *= GameMaster::get().stab_multiplier;
-	}
-	multiplier *= GameMaster::get().effectiveness(move->poketype, defender->poketype1);
-	multiplier *= GameMaster::get().effectiveness(move->poketype, defender->poketype2);
-
-	return 0.5 * attacker->attack / defender->defense * move->power * multiplier + 1;
+	return calc_damage(attacker, move, defender, multiplier, GameMaster::current());
 }
 
-Pokemon::Pokemon(int t_poketype1, int t_poketype2, double t_attack, double t_defense, int t_max_hp, int t_starting_energy)
-	: poketype1(t_poketype1), poketype2(t_poketype2), attack(t_attack), defense(t_defense), max_hp(t_max_hp), starting_energy(t_starting_energy)
-{
-}
-
-Pokemon::Pokemon(const Pokemon &other)
+int calc_damage(const Pokemon *attacker,
+				const Move *move,
+				const Pokemon *defender,
+				double multiplier,
+				const GameMaster &gm)
 {
-	*this = other;
+	return calc_damage(attacker, move, defender, GameMaster::type_pair(defender->poketype1, defender->poketype2), multiplier, gm);
 }
 
-Pokemon &Pokemon::operator=(const Pokemon &other)
+int calc_damage(const Pokemon *attacker,
+				const Move *move,
+				const Pokemon *defender,
+				unsigned defender_type_pair,
+				double multiplier,
+				const GameMaster &gm)
 {
-	poketype1 = other.poketype1;
-	poketype2 = other.poketype2;
-	attack = other.attack;
-	defense = other.defense;
-	max_hp = other.max_hp;
-	starting_energy = other.starting_energy;
-	immortal = other.immortal;
-
-	fmove = other.fmove;
-	cmoves_count = other.cmoves_count;
-	for (unsigned i = 0; i < other.cmoves_count; ++i)
+	if (move->poketype == attacker->poketype1 || move->poketype == attacker->poketype2)
 	{
-		cmoves[i] = other.cmoves[i];
+		multiplier *= gm.stab_multiplier;
 	}
-	cmove = cmoves + (other.cmove - other.cmoves);
+	multiplier *= gm.dual_effectiveness(move->poketype, defender_type_pair);
 
-	strategy = other.strategy;
+	return 0.5 * attacker->attack / defender->defense * move->power * multiplier + 1;
+}
 
-	return *this;
+int calc_max_hp(int base_stm, int iv, double cpm)
+{
+	return std::max(10, static_cast<int>(floor((base_stm + iv) * cpm)));
 }
 
-Pokemon::~Pokemon()
+Pokemon::Pokemon(int t_poketype1, int t_poketype2, double t_attack, double t_defense, int t_max_hp, int t_starting_energy)
+	: poketype1(t_poketype1), poketype2(t_poketype2), attack(t_attack), defense(t_defense), max_hp(t_max_hp), starting_energy(t_starting_energy)
 {
-	erase_cmoves();
 }
 
 const Move *Pokemon::get_fmove(unsigned) const
 {
-	return &fmove;
+	return fmove;
 }
 
 void Pokemon::add_fmove(const Move *t_move)
 {
 	if (t_move != nullptr)
 	{
-		fmove = *t_move;
+		fmove = intern_move(*t_move);
 	}
 }
 
@@ -80,7 +72,7 @@ const Move *Pokemon::get_cmove(unsigned t_index) const
 {
 	if (0 <= t_index && t_index < cmoves_count)
 	{
-		return cmoves + t_index;
+		return cmoves[t_index];
 	}
 	else
 	{
@@ -88,6 +80,21 @@ const Move *Pokemon::get_cmove(unsigned t_index) const
 	}
 }
 
+unsigned Pokemon::get_cmoves_count() const
+{
+	return cmoves_count;
+}
+
+unsigned Pokemon::get_cmove_index(const Move *t_cmove) const
+{
+	unsigned i = 0;
+	while (i + 1 < cmoves_count && cmoves[i] != t_cmove)
+	{
+		++i;
+	}
+	return i;
+}
+
 void Pokemon::add_cmove(const Move *t_move)
 {
 	if (t_move == nullptr)
@@ -99,10 +106,10 @@ void Pokemon::add_cmove(const Move *t_move)
 		sprintf(err_msg, "too many cmoves (max %d)", MAX_NUM_CMOVES);
 		throw std::runtime_error(err_msg);
 	}
-	cmoves[cmoves_count] = *t_move;
+	cmoves[cmoves_count] = intern_move(*t_move);
 	if (cmove == nullptr)
 	{
-		cmove = cmoves + cmoves_count;
+		cmove = cmoves[cmoves_count];
 	}
 	++cmoves_count;
 }
@@ -31,12 +31,12 @@ bool PokemonState::is_alive() const
     return hp > 0 || immortal;
 }
 
-void PokemonState::charge(int t_energy_delta)
+void PokemonState::charge(int t_energy_delta, const GameMaster &gm)
 {
     energy += t_energy_delta;
-    if (energy > static_cast<int>(GameMaster::get().max_energy))
+    if (energy > static_cast<int>(gm.max_energy))
     {
-        energy = GameMaster::get().max_energy;
+        energy = gm.max_energy;
     }
 }
 
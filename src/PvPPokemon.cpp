@@ -1,8 +1,6 @@
 
 #include "PvPPokemon.h"
 
-#include "GameMaster.h"
-
 namespace GoBattleSim
 {
 
@@ -16,22 +14,21 @@ PvPPokemon::PvPPokemon(int t_poketype1, int t_poketype2, double t_attack, double
 	num_shields_max = 0;
 }
 
-PvPPokemon::PvPPokemon(const PvPPokemon &other)
-	: Pokemon(other)
-{
-	attack_stage = other.attack_stage;
-	defense_stage = other.defense_stage;
-	attack_init = other.attack_init;
-	defense_init = other.defense_init;
-	num_shields_max = other.num_shields_max;
-}
-
 PvPPokemon::~PvPPokemon()
 {
 }
 
 void PvPPokemon::init()
 {
+	const auto &gm = GameMaster::current();
+	m_min_stage = gm.min_stage;
+	m_max_stage = gm.max_stage;
+	for (int stage = m_min_stage; stage <= m_max_stage; ++stage)
+	{
+		m_stage_attacks[stage - m_min_stage] = attack_init * gm.atk_stage_multiplier(stage);
+		m_stage_defenses[stage - m_min_stage] = defense_init * gm.def_stage_multiplier(stage);
+	}
+
 	attack_stage = 0;
 	defense_stage = 0;
 	attack = attack_init;
@@ -41,14 +38,14 @@ void PvPPokemon::init()
 void PvPPokemon::buff(int t_attack_stage_delta, int t_defense_stage_delta)
 {
 	attack_stage += t_attack_stage_delta;
-	attack_stage = attack_stage > GameMaster::get().max_stage ? GameMaster::get().max_stage : attack_stage;
-	attack_stage = attack_stage < GameMaster::get().min_stage ? GameMaster::get().min_stage : attack_stage;
-	attack = attack_init * GameMaster::get().atk_stage_multiplier(attack_stage);
+	attack_stage = attack_stage > m_max_stage ? m_max_stage : attack_stage;
+	attack_stage = attack_stage < m_min_stage ? m_min_stage : attack_stage;
+	attack = m_stage_attacks[attack_stage - m_min_stage];
 
 	defense_stage += t_defense_stage_delta;
-	defense_stage = defense_stage > GameMaster::get().max_stage ? GameMaster::get().max_stage : defense_stage;
-	defense_stage = defense_stage < GameMaster::get().min_stage ? GameMaster::get().min_stage : defense_stage;
-	defense = defense_init * GameMaster::get().def_stage_multiplier(defense_stage);
+	defense_stage = defense_stage > m_max_stage ? m_max_stage : defense_stage;
+	defense_stage = defense_stage < m_min_stage ? m_min_stage : defense_stage;
+	defense = m_stage_defenses[defense_stage - m_min_stage];
 }
 
 } // namespace GoBattleSim
@@ -28,7 +28,9 @@ void pvp_basic_on_free(const PvPStrategyInput &si, Action *r_action)
  */
 void pvp_advance_on_free(const PvPStrategyInput &si, Action *r_action)
 {
-	int my_fmove_damage = calc_damage(si.subject, si.subject->get_fmove(0), si.enemy, GameMaster::get().fast_attack_bonus_multiplier);
+	const auto &gm = *si.game_master;
+	auto enemy_types = GameMaster::type_pair(si.enemy->poketype1, si.enemy->poketype2);
+	int my_fmove_damage = calc_damage(si.subject, si.subject->get_fmove(0), si.enemy, enemy_types, gm.fast_attack_bonus_multiplier, gm);
 	if (my_fmove_damage >= si.enemy_hp)
 	{
 		r_action->type = ActionType::Fast;
@@ -43,7 +45,7 @@ void pvp_advance_on_free(const PvPStrategyInput &si, Action *r_action)
 	for (unsigned i = 0; i < si.subject->cmoves_count; ++i)
 	{
 		auto move = si.subject->get_cmove(i);
-		int damage = calc_damage(si.subject, move, si.enemy, GameMaster::get().charged_attack_bonus_multiplier);
+		int damage = calc_damage(si.subject, move, si.enemy, enemy_types, gm.charged_attack_bonus_multiplier, gm);
 		double dpe = (double)damage / (-move->energy);
 		if (dpe > higher_dpe)
 		{
@@ -73,7 +75,7 @@ void pvp_advance_on_free(const PvPStrategyInput &si, Action *r_action)
 	}
 	else if (si.subject_energy + si.subject->get_cmove(cheaper_move_idx)->energy >= 0)
 	{
-		if (cheaper_move_ko || calc_damage(si.enemy, &si.enemy->fmove, si.subject, GameMaster::get().fast_attack_bonus_multiplier) >= si.subject_hp)
+		if (cheaper_move_ko || calc_damage(si.enemy, si.enemy->fmove, si.subject, gm.fast_attack_bonus_multiplier, gm) >= si.subject_hp)
 		{
 			r_action->type = ActionType::Charged;
 			r_action->value = cheaper_move_idx;
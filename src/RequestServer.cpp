@@ -0,0 +1,240 @@
+#include "RequestServer.h"
+
+#include "ResultCache.h"
+#include "json.hpp"
+
+#include <algorithm>
+
+namespace GoBattleSim
+{
+
+// number of latest requests kept for latency percentiles
+constexpr size_t MAX_NUM_LATENCIES = 4096;
+
+RequestServer::RequestServer(unsigned num_workers, unsigned max_queue)
+	: m_max_queue(max_queue)
+{
+	num_workers = num_workers > 0 ? num_workers : 1;
+	for (unsigned i = 0; i < num_workers; ++i)
+	{
+		m_workers.emplace_back(&RequestServer::work, this);
+	}
+}
+
+RequestServer::~RequestServer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_cond.notify_all();
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+static nlohmann::json get_id(const std::string &request)
+{
+	try
+	{
+		return nlohmann::json::parse(request).value("id", nlohmann::json());
+	}
+	catch (const std::exception &)
+	{
+		return nullptr;
+	}
+}
+
+bool RequestServer::handle_command(const std::string &request, const Reply_t &reply)
+{
+	nlohmann::json request_j;
+	try
+	{
+		request_j = nlohmann::json::parse(request);
+	}
+	catch (const std::exception &)
+	{
+		return false;
+	}
+	auto it = request_j.find("command");
+	if (!request_j.is_object() || it == request_j.end())
+	{
+		return false;
+	}
+	auto id = request_j.value("id", nlohmann::json());
+	if (*it == "stats")
+	{
+		reply("{\"id\":" + id.dump() + ",\"stats\":" + stats() + "}");
+	}
+	else
+	{
+		reply(nlohmann::json({{"id", id}, {"error", "unknown command: " + it->dump()}}).dump());
+	}
+	return true;
+}
+
+void RequestServer::submit(std::string request, Reply_t reply)
+{
+	// only requests that mention a command are parsed here, simulations are parsed by the workers
+	if (request.find("\"command\"") != std::string::npos && handle_command(request, reply))
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_max_queue == 0 || m_jobs.size() < m_max_queue)
+		{
+			m_jobs.push_back({std::move(request), std::move(reply), Clock_t::now()});
+			m_cond.notify_one();
+			return;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_stats_mutex);
+		++m_num_rejected;
+	}
+	reply(nlohmann::json({{"id", get_id(request)}, {"error", "server busy"}}).dump());
+}
+
+void RequestServer::record_latency(double latency_ms)
+{
+	std::lock_guard<std::mutex> lock(m_stats_mutex);
+	++m_num_done;
+	if (m_latencies.size() < MAX_NUM_LATENCIES)
+	{
+		m_latencies.push_back(latency_ms);
+	}
+	else
+	{
+		m_latencies[m_next_latency] = latency_ms;
+	}
+	m_next_latency = (m_next_latency + 1) % MAX_NUM_LATENCIES;
+}
+
+std::string RequestServer::stats()
+{
+	nlohmann::json j;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		j["numWorkers"] = m_workers.size();
+		j["numInFlight"] = m_num_running;
+		j["queueDepth"] = m_jobs.size();
+		j["maxQueue"] = m_max_queue;
+	}
+	std::vector<double> latencies;
+	{
+		std::lock_guard<std::mutex> lock(m_stats_mutex);
+		j["numDone"] = m_num_done;
+		j["numRejected"] = m_num_rejected;
+		latencies = m_latencies;
+	}
+	j["cacheHits"] = ResultCache::get().num_hits();
+	j["cacheMisses"] = ResultCache::get().num_misses();
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&](double p) {
+		return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(p * (latencies.size() - 1) + 0.5)];
+	};
+	j["latencyMs"] = {
+		{"p50", percentile(0.5)},
+		{"p90", percentile(0.9)},
+		{"p99", percentile(0.99)},
+		{"max", percentile(1.0)},
+	};
+	return j.dump();
+}
+
+void RequestServer::work()
+{
+	auto ctx = GBS_create_context();
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+			if (m_jobs.empty())
+			{
+				break;
+			}
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			++m_num_running;
+		}
+		job.reply(handle(ctx, job.request));
+		record_latency(std::chrono::duration<double, std::milli>(Clock_t::now() - job.submit_time).count());
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_num_running;
+		}
+		m_idle.notify_all();
+	}
+	GBS_destroy_context(ctx);
+}
+
+std::string RequestServer::handle(GBS_Context *ctx, const std::string &request)
+{
+	nlohmann::json id;
+	nlohmann::json request_j;
+	try
+	{
+		request_j = nlohmann::json::parse(request);
+		auto it = request_j.find("id");
+		if (it != request_j.end())
+		{
+			id = std::move(*it);
+			request_j.erase("id");
+		}
+	}
+	catch (const std::exception &e)
+	{
+		return nlohmann::json({{"id", nullptr}, {"error", e.what()}}).dump();
+	}
+
+	// the output is already compact JSON, so it is spliced in without parsing it again
+	auto input = request_j.dump();
+	size_t output_size = 0;
+	const void *output = nullptr;
+	if (GBS_prepare_ctx(ctx, input.c_str()) == 0 && GBS_run_ctx(ctx) == 0)
+	{
+		output = GBS_collect_encoded_ctx(ctx, GBS_ENCODING_JSON_COMPACT, &output_size);
+	}
+	if (output == nullptr)
+	{
+		return nlohmann::json({{"id", id}, {"error", GBS_error_ctx(ctx)}}).dump();
+	}
+	std::string response = "{\"id\":" + id.dump() + ",\"output\":";
+	response.append(static_cast<const char *>(output), output_size);
+	response += '}';
+	return response;
+}
+
+void RequestServer::serve(std::istream &in, std::ostream &out)
+{
+	std::mutex out_mutex;
+	auto reply = [&](const std::string &response) {
+		std::lock_guard<std::mutex> lock(out_mutex);
+		out << response << '\n';
+		out.flush();
+	};
+
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (line.find_first_not_of(" \t\r") != std::string::npos)
+		{
+			submit(std::move(line), reply);
+		}
+	}
+
+	// the replies write to out, so it must outlive them
+	wait_idle();
+}
+
+void RequestServer::wait_idle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_jobs.empty() && m_num_running == 0; });
+}
+
+} // namespace GoBattleSim
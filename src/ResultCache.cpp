@@ -0,0 +1,196 @@
+#include "ResultCache.h"
+
+#include <atomic>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace GoBattleSim
+{
+
+std::string hash_key(const std::string &data)
+{
+	// 128-bit FNV-1a in two 64-bit halves, as not every compiler has a 128-bit integer;
+	// the prime is 2^88 + 0x13b
+	uint64_t hi = 0x6c62272e07bb0142ULL, lo = 0x62b821756295c58dULL;
+	for (unsigned char c : data)
+	{
+		lo ^= c;
+		// (hi, lo) * 0x13b, with the 32-bit halves of lo multiplied apart to keep the carry
+		uint64_t lo_lo = (lo & 0xffffffffULL) * 0x13b, lo_hi = (lo >> 32) * 0x13b;
+		uint64_t mid = (lo_lo >> 32) + (lo_hi & 0xffffffffULL);
+		uint64_t carry = (lo_hi >> 32) + (mid >> 32);
+		// plus (hi, lo) << 88, of which only lo << 24 is left in hi
+		hi = hi * 0x13b + carry + (lo << 24);
+		lo = (lo_lo & 0xffffffffULL) | (mid << 32);
+	}
+	char hex[33];
+	snprintf(hex, sizeof(hex), "%016llx%016llx",
+			 static_cast<unsigned long long>(hi), static_cast<unsigned long long>(lo));
+	return hex;
+}
+
+ResultCache ResultCache::instance;
+
+ResultCache &ResultCache::get()
+{
+	return instance;
+}
+
+void ResultCache::configure(size_t max_entries, const std::string &dir)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_max_entries = max_entries;
+	m_dir = dir;
+	while (m_entries.size() > m_max_entries)
+	{
+		m_index.erase(m_entries.back().first);
+		m_entries.pop_back();
+	}
+}
+
+bool ResultCache::enabled() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_max_entries > 0 || !m_dir.empty();
+}
+
+bool ResultCache::find(const std::string &key, std::string &value)
+{
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			value = it->second->second;
+			++m_num_hits;
+			return true;
+		}
+		if (m_dir.empty())
+		{
+			++m_num_misses;
+			return false;
+		}
+		path = m_dir + "/" + key;
+	}
+
+	// the file is read without holding the lock
+	FILE *file = fopen(path.c_str(), "rb");
+	bool found = file != nullptr;
+	if (found)
+	{
+		value.clear();
+		char buf[65536];
+		size_t num_read;
+		while ((num_read = fread(buf, 1, sizeof(buf), file)) > 0)
+		{
+			value.append(buf, num_read);
+		}
+		fclose(file);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (found)
+	{
+		++m_num_hits;
+		insert_memory(key, value);
+	}
+	else
+	{
+		++m_num_misses;
+	}
+	return found;
+}
+
+void ResultCache::insert(const std::string &key, const std::string &value)
+{
+	std::string dir;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		insert_memory(key, value);
+		dir = m_dir;
+	}
+	if (dir.empty())
+	{
+		return;
+	}
+
+	// write to a temporary file first, so that readers never see a partial output;
+	// the name is unique across the threads and processes sharing the directory
+	static std::atomic<uint64_t> num_tmp_files(0);
+	std::string path = dir + "/" + key;
+	std::string tmp_path = path + ".tmp" + std::to_string(getpid()) + "-" + std::to_string(num_tmp_files++);
+	FILE *file = fopen(tmp_path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return;
+	}
+	bool ok = fwrite(value.data(), 1, value.size(), file) == value.size();
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+	{
+		remove(tmp_path.c_str());
+	}
+}
+
+void ResultCache::discard(const std::string &key)
+{
+	std::string dir;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			m_entries.erase(it->second);
+			m_index.erase(it);
+		}
+		--m_num_hits;
+		++m_num_misses;
+		dir = m_dir;
+	}
+	if (!dir.empty())
+	{
+		remove((dir + "/" + key).c_str());
+	}
+}
+
+void ResultCache::insert_memory(const std::string &key, const std::string &value)
+{
+	if (m_max_entries == 0)
+	{
+		return;
+	}
+	auto it = m_index.find(key);
+	if (it != m_index.end())
+	{
+		m_entries.erase(it->second);
+	}
+	m_entries.emplace_front(key, value);
+	m_index[key] = m_entries.begin();
+	while (m_entries.size() > m_max_entries)
+	{
+		m_index.erase(m_entries.back().first);
+		m_entries.pop_back();
+	}
+}
+
+uint64_t ResultCache::num_hits() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_num_hits;
+}
+
+uint64_t ResultCache::num_misses() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_num_misses;
+}
+
+} // namespace GoBattleSim
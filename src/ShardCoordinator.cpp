@@ -0,0 +1,261 @@
+#include "ShardCoordinator.h"
+
+#include "GameMaster.h"
+#include "MatrixWriter.h"
+
+#include "json.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace GoBattleSim
+{
+
+std::vector<std::string> read_worker_commands(const std::string &hosts_path)
+{
+	std::ifstream ifs(hosts_path);
+	if (!ifs.good())
+	{
+		snprintf(err_msg, sizeof(err_msg), "bad file: %s", hosts_path.c_str());
+		throw std::runtime_error(err_msg);
+	}
+	std::vector<std::string> commands;
+	std::string line;
+	while (std::getline(ifs, line))
+	{
+		auto first = line.find_first_not_of(" \t\r");
+		if (first == std::string::npos || line[first] == '#')
+		{
+			continue;
+		}
+		auto last = line.find_last_not_of(" \t\r");
+		commands.push_back(line.substr(first, last - first + 1));
+	}
+	return commands;
+}
+
+static std::string quote(const std::string &arg)
+{
+	std::string quoted = "'";
+	for (auto c : arg)
+	{
+		quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+	}
+	return quoted + "'";
+}
+
+#ifndef _WIN32
+
+static pid_t spawn_worker(const ShardOptions &options, unsigned worker, const std::string &tile_input)
+{
+	std::vector<std::string> args;
+	if (options.worker_commands.empty())
+	{
+		args.push_back(options.gbs_path);
+		args.push_back(tile_input);
+		if (!options.game_master_path.empty())
+		{
+			args.push_back(options.game_master_path);
+		}
+	}
+	else
+	{
+		std::string command = options.worker_commands[worker] + " " + quote(tile_input);
+		if (!options.game_master_path.empty())
+		{
+			command += " " + quote(options.game_master_path);
+		}
+		args = {"/bin/sh", "-c", command};
+	}
+	std::vector<char *> argv;
+	for (auto &arg : args)
+	{
+		argv.push_back(&arg[0]);
+	}
+	argv.push_back(nullptr);
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		sprintf(err_msg, "fork failed: %s", strerror(errno));
+		throw std::runtime_error(err_msg);
+	}
+	if (pid == 0)
+	{
+		// the tile goes to its output file, so the worker's JSON summary is not needed
+		int null_fd = open("/dev/null", O_WRONLY);
+		if (null_fd >= 0)
+		{
+			dup2(null_fd, STDOUT_FILENO);
+			close(null_fd);
+		}
+		execvp(argv[0], argv.data());
+		_exit(127);
+	}
+	return pid;
+}
+
+std::string run_sharded(const std::string &input, const ShardOptions &options)
+{
+	auto input_j = nlohmann::json::parse(input);
+	auto mode_str = input_j.value("battleMode", std::string());
+	std::transform(mode_str.begin(), mode_str.end(), mode_str.begin(), ::tolower);
+	if (mode_str != "battlematrix")
+	{
+		sprintf(err_msg, "sharded mode only supports battle matrix input");
+		throw std::runtime_error(err_msg);
+	}
+	if (input_j.find("teamSearch") != input_j.end() ||
+		input_j.find("rowRange") != input_j.end() ||
+		input_j.find("colRange") != input_j.end())
+	{
+		sprintf(err_msg, "sharded mode does not support teamSearch, rowRange or colRange");
+		throw std::runtime_error(err_msg);
+	}
+
+	auto num_rows = input_j["rowPokemon"].size(), num_cols = input_j["colPokemon"].size();
+	num_rows = num_rows > 0 ? num_rows : num_cols;
+	num_cols = num_cols > 0 ? num_cols : num_rows;
+	unsigned num_workers = options.worker_commands.empty() ? options.num_workers : options.worker_commands.size();
+	num_workers = std::min<unsigned>(num_workers, num_rows);
+	if (num_workers == 0)
+	{
+		sprintf(err_msg, "no workers or no rows to run");
+		throw std::runtime_error(err_msg);
+	}
+
+	std::string output_file = input_j.value("outputFile", std::string());
+	MatrixFileFormat output_format = parse_matrix_file_format(input_j.value("outputFormat", std::string("float64")));
+	input_j.erase("outputFile");
+	input_j.erase("outputFormat");
+
+	const char *tmp_dir = getenv("TMPDIR");
+	std::string dir_template = std::string(tmp_dir != nullptr ? tmp_dir : "/tmp") + "/gbs_shard_XXXXXX";
+	if (mkdtemp(&dir_template[0]) == nullptr)
+	{
+		sprintf(err_msg, "cannot create scratch directory: %s", strerror(errno));
+		throw std::runtime_error(err_msg);
+	}
+	const std::string &dir = dir_template;
+
+	// row bands keep every tile made of full rows, so they can be merged into a streamed file
+	std::vector<std::string> tile_inputs(num_workers), tile_outputs(num_workers);
+	std::vector<pid_t> pids;
+	auto cleanup = [&]() {
+		for (unsigned i = 0; i < num_workers; ++i)
+		{
+			remove(tile_inputs[i].c_str());
+			remove(tile_outputs[i].c_str());
+		}
+		rmdir(dir.c_str());
+	};
+	unsigned row_first = 0;
+	for (unsigned i = 0; i < num_workers; ++i)
+	{
+		unsigned num_band_rows = num_rows / num_workers + (num_rows % num_workers > i ? 1 : 0);
+		tile_inputs[i] = dir + "/tile_" + std::to_string(i) + ".json";
+		tile_outputs[i] = dir + "/tile_" + std::to_string(i) + ".gbsm";
+		input_j["rowRange"] = {row_first, row_first + num_band_rows};
+		input_j["outputFile"] = tile_outputs[i];
+		input_j["outputFormat"] = "float64";
+		row_first += num_band_rows;
+		// a failed write would only show up later as a worker failing to parse its input
+		std::ofstream ofs(tile_inputs[i]);
+		ofs << input_j.dump();
+		ofs.close();
+		if (!ofs)
+		{
+			cleanup();
+			snprintf(err_msg, sizeof(err_msg), "cannot write worker input: %s", tile_inputs[i].c_str());
+			throw std::runtime_error(err_msg);
+		}
+	}
+
+	auto reap = [&]() {
+		unsigned num_failed = 0;
+		for (auto pid : pids)
+		{
+			int status = 0;
+			waitpid(pid, &status, 0);
+			num_failed += WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+		}
+		return num_failed;
+	};
+	try
+	{
+		for (unsigned i = 0; i < num_workers; ++i)
+		{
+			pids.push_back(spawn_worker(options, i, tile_inputs[i]));
+		}
+	}
+	catch (...)
+	{
+		// the workers already started would write into the scratch directory, so stop them first
+		for (auto pid : pids)
+		{
+			kill(pid, SIGTERM);
+		}
+		reap();
+		cleanup();
+		throw;
+	}
+
+	unsigned num_failed = reap();
+	if (num_failed > 0)
+	{
+		cleanup();
+		sprintf(err_msg, "%u of %u workers failed", num_failed, num_workers);
+		throw std::runtime_error(err_msg);
+	}
+
+	nlohmann::json output_j;
+	try
+	{
+		if (!output_file.empty())
+		{
+			MatrixWriter writer(output_file, output_format);
+			merge_matrix_tiles(tile_outputs, writer);
+			output_j["outputFile"] = output_file;
+			output_j["outputFormat"] = matrix_file_format_name(output_format);
+			output_j["numRows"] = writer.header().num_rows;
+			output_j["numCols"] = writer.header().num_cols;
+		}
+		else
+		{
+			std::vector<std::vector<double>> matrix;
+			merge_matrix_tiles(tile_outputs, matrix);
+			output_j = matrix;
+		}
+	}
+	catch (...)
+	{
+		cleanup();
+		throw;
+	}
+	cleanup();
+	return output_j.dump(4);
+}
+
+#else
+
+std::string run_sharded(const std::string &, const ShardOptions &)
+{
+	sprintf(err_msg, "sharded mode is not supported on this platform");
+	throw std::runtime_error(err_msg);
+}
+
+#endif
+
+} // namespace GoBattleSim
@@ -1,6 +1,8 @@
 
 #include "SimplePvPBattle.h"
 #include "GameMaster.h"
+#include "PerfCounters.h"
+#include "Random.h"
 
 #include <cstdlib>
 #include <stdio.h>
@@ -11,6 +13,14 @@ namespace GoBattleSim
 
 SimplePvPBattle::SimplePvPBattle(const SimplePvPBattle &other)
 {
+	copy_state(other);
+	m_branch[0] = nullptr;
+	m_branch[1] = nullptr;
+}
+
+void SimplePvPBattle::copy_state(const SimplePvPBattle &other)
+{
+	m_game_master = other.m_game_master;
 	m_pkm[0] = other.m_pkm[0];
 	m_pkm[1] = other.m_pkm[1];
 	m_pkm_states[0] = other.m_pkm_states[0];
@@ -24,8 +34,20 @@ SimplePvPBattle::SimplePvPBattle(const SimplePvPBattle &other)
 	m_num_shields_max[1] = other.m_num_shields_max[1];
 	m_strategies[0] = other.m_strategies[0];
 	m_strategies[1] = other.m_strategies[1];
-	m_branch[0] = nullptr;
-	m_branch[1] = nullptr;
+	m_branched = false;
+}
+
+SimplePvPBattle *SimplePvPBattle::make_branch(int k)
+{
+	if (m_branch[k])
+	{
+		m_branch[k]->copy_state(*this);
+	}
+	else
+	{
+		m_branch[k] = new SimplePvPBattle(*this);
+	}
+	return m_branch[k];
 }
 
 SimplePvPBattle::~SimplePvPBattle()
@@ -83,6 +105,7 @@ void SimplePvPBattle::set_enable_branching(bool enable)
 
 void SimplePvPBattle::init()
 {
+	m_game_master = &GameMaster::current();
 	for (int i = 0; i < 2; ++i)
 	{
 		m_pkm[i].init();
@@ -94,6 +117,7 @@ void SimplePvPBattle::init()
 	}
 	m_turn = 0;
 	m_ended = false;
+	m_branched = false;
 	erase_log();
 }
 
@@ -127,6 +151,7 @@ void SimplePvPBattle::go()
 		{
 			if (m_pkm_states[i].decision.type == ActionType::None && m_pkm_states[i].cooldown <= 0)
 			{
+				GBS_PERF_COUNT(PerfCounters::local().count_call(StrategyCallback::OnFree));
 				m_strategies[i].on_free(generate_strat_input(i), &(m_pkm_states[i].decision));
 			}
 		}
@@ -201,12 +226,13 @@ void SimplePvPBattle::register_action_fast(Player_Index_t i, const Action &t_act
 {
 	auto move = m_pkm[i].get_fmove(0);
 	m_pkm_states[i].energy += move->energy;
-	if (m_pkm_states[i].energy > static_cast<int>(GameMaster::get().max_energy))
+	if (m_pkm_states[i].energy > static_cast<int>(m_game_master->max_energy))
 	{
-		m_pkm_states[i].energy = GameMaster::get().max_energy;
+		m_pkm_states[i].energy = m_game_master->max_energy;
 	}
-	auto damage = calc_damage(&m_pkm[i], move, &m_pkm[1 - i], GameMaster::get().fast_attack_bonus_multiplier);
+	auto damage = calc_damage(&m_pkm[i], move, &m_pkm[1 - i], m_game_master->fast_attack_bonus_multiplier, *m_game_master);
 	m_pkm_states[1 - i].hp -= damage;
+	GBS_PERF_COUNT(PerfCounters::local().count_event(EventType::Fast));
 
 	m_pkm_states[i].cooldown = move->duration;
 	m_pkm_states[i].decision.type = ActionType::None;
@@ -237,12 +263,14 @@ void SimplePvPBattle::register_action_charged(Player_Index_t i, const Action &t_
 		Action action{m_turn, ActionType::Dodge}; // Default use shield, unless strategy decides otherwise
 		if (m_strategies[1 - i].on_attack)
 		{
+			GBS_PERF_COUNT(PerfCounters::local().count_call(StrategyCallback::OnAttack));
 			m_strategies[1 - i].on_attack(generate_strat_input(1 - i), &action);
 		}
 		if (action.type == ActionType::Dodge)
 		{
 			damage = 1;
 			--m_pkm_states[1 - i].shields;
+			GBS_PERF_COUNT(PerfCounters::local().count_event(EventType::Dodge));
 			if (m_enable_log)
 			{
 				append_log({m_turn,
@@ -254,9 +282,10 @@ void SimplePvPBattle::register_action_charged(Player_Index_t i, const Action &t_
 	}
 	if (damage == 0)
 	{
-		damage = calc_damage(&m_pkm[i], move, &m_pkm[1 - i], GameMaster::get().charged_attack_bonus_multiplier);
+		damage = calc_damage(&m_pkm[i], move, &m_pkm[1 - i], m_game_master->charged_attack_bonus_multiplier, *m_game_master);
 	}
 	m_pkm_states[1 - i].hp -= damage;
+	GBS_PERF_COUNT(PerfCounters::local().count_event(EventType::Charged));
 	m_pkm_states[i].cooldown = 0;
 	m_pkm_states[1 - i].cooldown = 0;
 	m_pkm_states[i].decision.type = ActionType::None;
@@ -288,21 +317,23 @@ void SimplePvPBattle::decide_branch_charged_move_priority()
 
 	if (m_enable_branching)
 	{
-		m_branch[0] = new SimplePvPBattle(*this);
+		GBS_PERF_COUNT(PerfCounters::local().branch_nodes += 2);
+		make_branch(0);
 		m_branch_weight[0] = 0.5;
 		m_branch[0]->handle_simultaneous_charged_attacks(0);
 
-		m_branch[1] = new SimplePvPBattle(*this);
+		make_branch(1);
 		m_branch_weight[1] = 0.5;
 		m_branch[1]->handle_simultaneous_charged_attacks(1);
 
 		m_branch[0]->start();
 		m_branch[1]->start();
+		m_branched = true;
 		m_ended = true;
 	}
 	else
 	{
-		Player_Index_t first = rand() % 2u;
+		Player_Index_t first = random_int() % 2u;
 		handle_simultaneous_charged_attacks(first);
 	}
 }
@@ -327,20 +358,22 @@ void SimplePvPBattle::decide_branch_move_effect(Player_Index_t i, const MoveEffe
 
 	if (m_enable_branching)
 	{
-		m_branch[0] = new SimplePvPBattle(*this);
+		GBS_PERF_COUNT(PerfCounters::local().branch_nodes += 2);
+		make_branch(0);
 		m_branch_weight[0] = 1 - t_effect.activation_chance;
 
-		m_branch[1] = new SimplePvPBattle(*this);
+		make_branch(1);
 		m_branch_weight[1] = t_effect.activation_chance;
 		m_branch[1]->handle_move_effect(i, t_effect);
 
 		m_branch[0]->start();
 		m_branch[1]->start();
+		m_branched = true;
 		m_ended = true;
 	}
 	else
 	{
-		if ((double)(rand() % 10000) / 10000 < t_effect.activation_chance)
+		if ((double)(random_int() % 10000) / 10000 < t_effect.activation_chance)
 		{
 			handle_move_effect(i, t_effect);
 		}
@@ -363,6 +396,44 @@ void SimplePvPBattle::handle_fainted_pokemon(Player_Index_t i)
 	m_ended = true;
 }
 
+void SimplePvPBattle::write_trace(TraceWriter &trace, unsigned pid, const std::vector<TimelineEvent> &log) const
+{
+	const double turn_us = 500000;
+	for (Player_Index_t i = 0; i < 2; ++i)
+	{
+		trace.name_track(pid, i, "player " + std::to_string(i));
+	}
+	for (const auto &event : log)
+	{
+		double ts = event.time * turn_us;
+		switch (event.type)
+		{
+		case EventType::Enter:
+			trace.add_span("Enter", "battle", pid, event.player, ts, turn_us);
+			break;
+		case EventType::Fast:
+			// the damage is dealt on the first turn, then the Pokemon cools down
+			trace.add_span("Fast", "battle", pid, event.player, ts, m_pkm[event.player].get_fmove(0)->duration * turn_us);
+			break;
+		case EventType::Charged:
+			trace.add_span("Charged", "battle", pid, event.player, ts, turn_us,
+						   "{\"cmove\": " + std::to_string(event.value) + "}");
+			break;
+		case EventType::Dodge:
+			trace.add_span("Shield", "battle", pid, event.player, ts, turn_us);
+			break;
+		case EventType::Damage:
+			trace.add_instant("Damage", "battle", pid, event.player, ts, "{\"damage\": " + std::to_string(event.value) + "}");
+			break;
+		case EventType::Exit:
+			trace.add_instant("Exit", "battle", pid, event.player, ts);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
 void SimplePvPBattle::append_log(TimelineEvent &&event)
 {
 	m_battle_log.emplace_back(std::move(event));
@@ -383,12 +454,13 @@ PvPStrategyInput SimplePvPBattle::generate_strat_input(Player_Index_t i)
 		m_pkm_states[i].energy,
 		m_pkm_states[1 - i].energy,
 		m_pkm_states[i].shields,
-		m_pkm_states[1 - i].shields};
+		m_pkm_states[1 - i].shields,
+		m_game_master};
 }
 
 SimplePvPBattleOutcome SimplePvPBattle::get_outcome()
 {
-	if (m_enable_branching && m_branch[0] && m_branch[1])
+	if (m_branched)
 	{
 		SimplePvPBattleOutcome branch[2] = {
 			m_branch[0]->get_outcome(),
@@ -0,0 +1,240 @@
+#include "SocketServer.h"
+
+#include "GameMaster.h"
+
+#include <errno.h>
+#include <memory>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace GoBattleSim
+{
+
+#ifndef _WIN32
+
+/**
+ * A connection is closed when the reader is done and the last reply holding it is gone.
+ */
+class Connection
+{
+public:
+	explicit Connection(int fd) : m_fd(fd)
+	{
+	}
+
+	~Connection()
+	{
+		close(m_fd);
+	}
+
+	bool read_line(std::string &line)
+	{
+		line.clear();
+		while (true)
+		{
+			auto newline = m_buf.find('\n');
+			if (newline != std::string::npos)
+			{
+				line = m_buf.substr(0, newline);
+				m_buf.erase(0, newline + 1);
+				return true;
+			}
+			char chunk[65536];
+			auto num_read = recv(m_fd, chunk, sizeof(chunk), 0);
+			if (num_read < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (num_read <= 0)
+			{
+				// the last line may not end with a new line
+				line.swap(m_buf);
+				return !line.empty();
+			}
+			// the buffer holds no line break here, so the line goes on to the first one in the chunk
+			auto newline_in_chunk = static_cast<const char *>(memchr(chunk, '\n', num_read));
+			if (m_buf.size() + (newline_in_chunk != nullptr ? newline_in_chunk - chunk : num_read) > MAX_REQUEST_SIZE)
+			{
+				m_buf.clear();
+				snprintf(chunk, sizeof(chunk), "{\"id\":null,\"error\":\"request longer than %zu bytes\"}", MAX_REQUEST_SIZE);
+				write_line(chunk);
+				return false;
+			}
+			m_buf.append(chunk, num_read);
+		}
+	}
+
+	void write_line(const std::string &line)
+	{
+		std::lock_guard<std::mutex> lock(m_write_mutex);
+		std::string data = line + '\n';
+		size_t offset = 0;
+		while (offset < data.size())
+		{
+			auto num_sent = send(m_fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+			if (num_sent < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (num_sent <= 0)
+			{
+				// the client is gone, nothing to reply to
+				return;
+			}
+			offset += num_sent;
+		}
+	}
+
+private:
+	int m_fd;
+	std::string m_buf;
+	std::mutex m_write_mutex;
+};
+
+static void serve_connection(RequestServer &server, std::shared_ptr<Connection> conn)
+{
+	std::string line;
+	while (conn->read_line(line))
+	{
+		if (line.find_first_not_of(" \t\r") != std::string::npos)
+		{
+			server.submit(std::move(line), [conn](const std::string &response) {
+				conn->write_line(response);
+			});
+		}
+	}
+}
+
+SocketServer::SocketServer(RequestServer &server, const std::string &address)
+	: m_server(server)
+{
+	// the destructor does not run for a failed constructor, so the socket is released here
+	auto fail = [&](const char *what) {
+		int error = errno;
+		if (m_fd >= 0)
+		{
+			close(m_fd);
+			m_fd = -1;
+		}
+		if (!m_unix_path.empty())
+		{
+			unlink(m_unix_path.c_str());
+		}
+		snprintf(err_msg, sizeof(err_msg), "%s %s: %s", what, address.c_str(), strerror(error));
+		throw std::runtime_error(err_msg);
+	};
+	if (address.compare(0, 5, "unix:") == 0)
+	{
+		m_unix_path = address.substr(5);
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		if (m_unix_path.size() >= sizeof(addr.sun_path))
+		{
+			sprintf(err_msg, "socket path too long: %s", m_unix_path.c_str());
+			throw std::runtime_error(err_msg);
+		}
+		strcpy(addr.sun_path, m_unix_path.c_str());
+		unlink(m_unix_path.c_str());
+		m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (m_fd < 0 || bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+		{
+			fail("cannot bind");
+		}
+	}
+	else
+	{
+		auto colon = address.rfind(':');
+		std::string host = colon != std::string::npos ? address.substr(0, colon) : "127.0.0.1";
+		int port = atoi(address.c_str() + (colon != std::string::npos ? colon + 1 : 0));
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		if (port <= 0 || inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(), &addr.sin_addr) != 1)
+		{
+			snprintf(err_msg, sizeof(err_msg), "bad address: %s", address.c_str());
+			throw std::runtime_error(err_msg);
+		}
+		// requests are not authenticated, so they are only taken from this machine
+		if ((ntohl(addr.sin_addr.s_addr) >> 24) != 127)
+		{
+			snprintf(err_msg, sizeof(err_msg), "not a loopback address: %s", address.c_str());
+			throw std::runtime_error(err_msg);
+		}
+		m_fd = socket(AF_INET, SOCK_STREAM, 0);
+		int reuse = 1;
+		if (m_fd < 0 || setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+			bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+		{
+			fail("cannot bind");
+		}
+	}
+	if (listen(m_fd, SOMAXCONN) != 0)
+	{
+		fail("cannot listen on");
+	}
+}
+
+SocketServer::~SocketServer()
+{
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+	}
+	if (!m_unix_path.empty())
+	{
+		unlink(m_unix_path.c_str());
+	}
+}
+
+void SocketServer::run()
+{
+	// a client closing early must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+	while (true)
+	{
+		int fd = accept(m_fd, nullptr, nullptr);
+		if (fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+			{
+				continue;
+			}
+			snprintf(err_msg, sizeof(err_msg), "accept failed: %s", strerror(errno));
+			throw std::runtime_error(err_msg);
+		}
+		std::thread(serve_connection, std::ref(m_server), std::make_shared<Connection>(fd)).detach();
+	}
+}
+
+#else
+
+SocketServer::SocketServer(RequestServer &server, const std::string &)
+	: m_server(server)
+{
+	sprintf(err_msg, "socket server is not supported on this platform");
+	throw std::runtime_error(err_msg);
+}
+
+SocketServer::~SocketServer()
+{
+}
+
+void SocketServer::run()
+{
+}
+
+#endif
+
+} // namespace GoBattleSim
@@ -12,7 +12,7 @@ inline int get_projected_energy(const StrategyInput &si)
 	int projected_energy = si.subject_state->energy;
 	if (si.subject_action.type == ActionType::Fast)
 	{
-		projected_energy += si.subject->fmove.energy;
+		projected_energy += si.subject->fmove->energy;
 	}
 	else if (si.subject_action.type == ActionType::Charged)
 	{
@@ -24,11 +24,11 @@ inline int get_projected_energy(const StrategyInput &si)
 inline int calc_damage_weather(const Pokemon *attacker,
 							   const Move *move,
 							   const Pokemon *defender,
-							   int weather)
+							   int weather,
+							   const GameMaster &gm)
 {
-	const auto &gm = GameMaster::get();
 	double multiplier = gm.boosted_weather(move->poketype) == weather ? gm.wab_multiplier : 1.0;
-	return calc_damage(attacker, move, defender, multiplier);
+	return calc_damage(attacker, move, defender, multiplier, gm);
 }
 
 void defender_on_clear(const StrategyInput &si, Action *r_action)
@@ -67,7 +67,7 @@ void attacker_fast_only_no_dodge_on_free(const StrategyInput &si, Action *r_acti
 
 void attacker_burst_no_dodge_on_free(const StrategyInput &si, Action *r_action)
 {
-	if (si.subject_state->energy >= static_cast<int>(GameMaster::get().max_energy))
+	if (si.subject_state->energy >= static_cast<int>(si.game_master->max_energy))
 	{
 		r_action->type = ActionType::Charged;
 	}
@@ -87,7 +87,7 @@ void attacker_dodge_charged_on_free(const StrategyInput &si, Action *r_action)
 	auto time_of_damage = 0u, time_of_enemy_cooldown = si.enemy_action.time;
 	if (si.enemy_action.type == ActionType::Fast)
 	{
-		time_of_enemy_cooldown += si.enemy->fmove.duration + 1500;
+		time_of_enemy_cooldown += si.enemy->fmove->duration + 1500;
 	}
 	else if (si.enemy_action.type == ActionType::Charged)
 	{
@@ -109,9 +109,9 @@ void attacker_dodge_charged_on_free(const StrategyInput &si, Action *r_action)
 	if (time_till_damage > si.subject->cmove->duration && si.subject_state->energy + si.subject->cmove->energy >= 0) // Can squeeze in one charge
 	{
 		r_action->type = ActionType::Charged;
-		r_action->value = si.subject->cmove - si.subject->cmoves;
+		r_action->value = si.subject->get_cmove_index(si.subject->cmove);
 	}
-	else if (time_till_damage > si.subject->fmove.duration) // Can squeeze in one fast
+	else if (time_till_damage > si.subject->fmove->duration) // Can squeeze in one fast
 	{
 		r_action->type = ActionType::Fast;
 	}
@@ -123,7 +123,7 @@ void attacker_dodge_charged_on_free(const StrategyInput &si, Action *r_action)
 		}
 		else
 		{
-			int delay = time_till_damage - GameMaster::get().dodge_window;
+			int delay = time_till_damage - si.game_master->dodge_window;
 			r_action->type = ActionType::Dodge;
 			r_action->delay = delay > 0 ? delay : 0;
 		}
@@ -153,15 +153,15 @@ void attacker_dodge_charged_on_attack(const StrategyInput &si, Action *r_action)
 	if (time_till_damage > si.subject->cmove->duration && si.subject_state->energy + si.subject->cmove->energy >= 0) // Can squeeze in one charge
 	{
 		r_action->type = ActionType::Charged;
-		r_action->value = si.subject->cmove - si.subject->cmoves;
+		r_action->value = si.subject->get_cmove_index(si.subject->cmove);
 	}
-	else if (time_till_damage > si.subject->fmove.duration) // Can squeeze in one fast
+	else if (time_till_damage > si.subject->fmove->duration) // Can squeeze in one fast
 	{
 		r_action->type = ActionType::Fast;
 	}
 	else // Just dodge
 	{
-		int delay = time_till_damage - GameMaster::get().dodge_window;
+		int delay = time_till_damage - si.game_master->dodge_window;
 		r_action->type = ActionType::Dodge;
 		r_action->delay = delay > 0 ? delay : 0;
 	}
@@ -173,8 +173,8 @@ void attacker_dodge_all_on_free(const StrategyInput &si, Action *r_action)
 	auto time_of_damage = 0u, time_of_enemy_cooldown = si.enemy_action.time;
 	if (si.enemy_action.type == ActionType::Fast)
 	{
-		time_of_damage = si.enemy_action.time + si.enemy->fmove.dws;
-		time_of_enemy_cooldown += si.enemy->fmove.duration + 1500;
+		time_of_damage = si.enemy_action.time + si.enemy->fmove->dws;
+		time_of_enemy_cooldown += si.enemy->fmove->duration + 1500;
 	}
 	else if (si.enemy_action.type == ActionType::Charged)
 	{
@@ -183,22 +183,22 @@ void attacker_dodge_all_on_free(const StrategyInput &si, Action *r_action)
 	}
 	else // enemy just enters battle
 	{
-		time_of_damage = si.enemy_action.time + 1500 + si.enemy->fmove.dws;
+		time_of_damage = si.enemy_action.time + 1500 + si.enemy->fmove->dws;
 		time_of_enemy_cooldown += 1500;
 	}
 	if (time_of_damage < si.time_free || time_of_damage < si.subject_state->damage_reduction_expiry)
 	{
 		// Predict next time of damage
-		time_of_damage = time_of_enemy_cooldown + si.enemy->fmove.dws;
+		time_of_damage = time_of_enemy_cooldown + si.enemy->fmove->dws;
 		predicted_attack = true;
 	}
 	int time_till_damage = time_of_damage - si.time_free;
 	if (time_till_damage > si.subject->cmove->duration && si.subject_state->energy + si.subject->cmove->energy >= 0) // Can squeeze in one charge
 	{
 		r_action->type = ActionType::Charged;
-		r_action->value = si.subject->cmove - si.subject->cmoves;
+		r_action->value = si.subject->get_cmove_index(si.subject->cmove);
 	}
-	else if (time_till_damage > si.subject->fmove.duration) // Can squeeze in one fast
+	else if (time_till_damage > si.subject->fmove->duration) // Can squeeze in one fast
 	{
 		r_action->type = ActionType::Fast;
 	}
@@ -210,7 +210,7 @@ void attacker_dodge_all_on_free(const StrategyInput &si, Action *r_action)
 		}
 		else
 		{
-			int delay = time_till_damage - GameMaster::get().dodge_window;
+			int delay = time_till_damage - si.game_master->dodge_window;
 			r_action->type = ActionType::Dodge;
 			r_action->delay = delay > 0 ? delay : 0;
 		}
@@ -222,7 +222,7 @@ void attacker_dodge_all_on_attack(const StrategyInput &si, Action *r_action)
 	unsigned time_of_damage;
 	if (si.enemy_action.type == ActionType::Fast)
 	{
-		time_of_damage = si.enemy_action.time + si.enemy->fmove.dws;
+		time_of_damage = si.enemy_action.time + si.enemy->fmove->dws;
 	}
 	else
 	{
@@ -239,24 +239,24 @@ void attacker_dodge_all_on_attack(const StrategyInput &si, Action *r_action)
 	if (time_till_damage > si.subject->cmove->duration && si.subject_state->energy + si.subject->cmove->energy >= 0) // Can squeeze in one charge
 	{
 		r_action->type = ActionType::Charged;
-		r_action->value = si.subject->cmove - si.subject->cmoves;
+		r_action->value = si.subject->get_cmove_index(si.subject->cmove);
 	}
-	else if (time_till_damage > si.subject->fmove.duration) // Can squeeze in one fast
+	else if (time_till_damage > si.subject->fmove->duration) // Can squeeze in one fast
 	{
 		r_action->type = ActionType::Fast;
 	}
 	else // Just dodge
 	{
-		int delay = time_till_damage - GameMaster::get().dodge_window;
+		int delay = time_till_damage - si.game_master->dodge_window;
 		r_action->type = ActionType::Dodge;
 		r_action->delay = delay > 0 ? delay : 0;
 	}
 }
 
-inline double calc_cycle_dps(const Pokemon *subj, const Move *fmove, const Move *cmove, const Pokemon *enemy, int weather)
+inline double calc_cycle_dps(const Pokemon *subj, const Move *fmove, const Move *cmove, const Pokemon *enemy, int weather, const GameMaster &gm)
 {
-	auto fdmg = calc_damage_weather(subj, fmove, enemy, weather);
-	auto cdmg = calc_damage_weather(subj, cmove, enemy, weather);
+	auto fdmg = calc_damage_weather(subj, fmove, enemy, weather, gm);
+	auto cdmg = calc_damage_weather(subj, cmove, enemy, weather, gm);
 	double fdps = static_cast<double>(fdmg) / fmove->duration;
 	double cdps = static_cast<double>(cdmg) / cmove->duration;
 	double feps = static_cast<double>(fmove->energy) / fmove->duration;
@@ -271,9 +271,10 @@ void attacker_combo_no_dodge_on_free(const StrategyInput &si, Action *action)
 	const Move *better = nullptr;
 	int cheaper_energy;
 	const Move *cheaper = nullptr;
-	for (auto cmove = si.subject->cmoves; cmove < si.subject->cmoves + si.subject->cmoves_count; ++cmove)
+	for (unsigned i = 0; i < si.subject->cmoves_count; ++i)
 	{
-		double cur_dps = calc_cycle_dps(si.subject, &si.subject->fmove, cmove, si.enemy, si.weather);
+		auto cmove = si.subject->get_cmove(i);
+		double cur_dps = calc_cycle_dps(si.subject, si.subject->fmove, cmove, si.enemy, si.weather, *si.game_master);
 		if (cur_dps > better_dps || better == nullptr)
 		{
 			better = cmove;
@@ -299,7 +300,7 @@ void attacker_combo_no_dodge_on_free(const StrategyInput &si, Action *action)
 		if (si.subject_state->energy + better->energy >= 0)
 		{
 			action->type = ActionType::Charged;
-			action->value = better - si.subject->cmoves;
+			action->value = si.subject->get_cmove_index(better);
 		}
 		return;
 	}
@@ -307,12 +308,12 @@ void attacker_combo_no_dodge_on_free(const StrategyInput &si, Action *action)
 	if (si.subject_state->energy + better->energy >= 0)
 	{
 		action->type = ActionType::Charged;
-		action->value = better - si.subject->cmoves;
+		action->value = si.subject->get_cmove_index(better);
 		return;
 	}
 
-	auto enemy_fdmg = calc_damage_weather(si.enemy, &si.enemy->fmove, si.subject, si.weather);
-	auto enemy_cdmg = calc_damage_weather(si.enemy, si.enemy->cmove, si.subject, si.weather);
+	auto enemy_fdmg = calc_damage_weather(si.enemy, si.enemy->fmove, si.subject, si.weather, *si.game_master);
+	auto enemy_cdmg = calc_damage_weather(si.enemy, si.enemy->cmove, si.subject, si.weather, *si.game_master);
 
 	if (si.subject_state->hp <= 2 * enemy_fdmg ||
 		(si.subject_state->hp <= enemy_cdmg && si.enemy_state->energy + si.enemy->cmove->energy >= 0))
@@ -320,7 +321,7 @@ void attacker_combo_no_dodge_on_free(const StrategyInput &si, Action *action)
 		if (si.subject_state->energy + cheaper->energy >= 0)
 		{
 			action->type = ActionType::Charged;
-			action->value = cheaper - si.subject->cmoves;
+			action->value = si.subject->get_cmove_index(cheaper);
 		}
 		return;
 	}
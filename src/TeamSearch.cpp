@@ -0,0 +1,295 @@
+#include "TeamSearch.h"
+
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdint.h>
+
+namespace GoBattleSim
+{
+
+/**
+ * Scores are searched in float, eight columns at a time so that the compiler can vectorize the inner loop.
+ * Wins against columns are packed in 64-bit masks and counted with popcount.
+ * The winning teams are re-scored in double at the end.
+ *
+ * Rows are searched in increasing index order (a < b < d). The column-wise max and the OR of wins
+ * over all rows after b bound the score of every team starting with (a, b),
+ * so the whole d loop is skipped once the bound cannot beat the current top-K.
+ */
+constexpr unsigned LANES = 8;
+
+struct TeamCandidate
+{
+	float key;
+	float tiebreak;
+	unsigned members[TEAM_SIZE];
+};
+
+// heap order: the worst candidate is on top
+static bool is_better(const TeamCandidate &lhs, const TeamCandidate &rhs)
+{
+	if (lhs.key != rhs.key)
+	{
+		return lhs.key > rhs.key;
+	}
+	if (lhs.tiebreak != rhs.tiebreak)
+	{
+		return lhs.tiebreak > rhs.tiebreak;
+	}
+	return std::lexicographical_compare(lhs.members, lhs.members + TEAM_SIZE, rhs.members, rhs.members + TEAM_SIZE);
+}
+
+struct TeamSearchData
+{
+	unsigned num_rows{0};
+	unsigned num_cols{0};
+	unsigned num_words{0};
+	std::vector<float> scores;		   // num_rows * num_cols
+	std::vector<uint64_t> wins;		   // num_rows * num_words
+	std::vector<float> suffix_scores;  // (num_rows + 1) * num_cols, max of rows i..
+	std::vector<uint64_t> suffix_wins; // (num_rows + 1) * num_words, OR of rows i..
+	TeamSearchOptions options;
+
+	const float *row(unsigned i) const
+	{
+		return scores.data() + static_cast<size_t>(i) * num_cols;
+	}
+
+	const uint64_t *row_wins(unsigned i) const
+	{
+		return wins.data() + static_cast<size_t>(i) * num_words;
+	}
+
+	const float *suffix_row(unsigned i) const
+	{
+		return suffix_scores.data() + static_cast<size_t>(i) * num_cols;
+	}
+
+	const uint64_t *suffix_row_wins(unsigned i) const
+	{
+		return suffix_wins.data() + static_cast<size_t>(i) * num_words;
+	}
+};
+
+/**
+ * Score of the team whose pair-wise best scores are @param pair_max, plus @param row.
+ */
+static TeamCandidate score_candidate(const TeamSearchData &data,
+									 const float *pair_max,
+									 const uint64_t *pair_wins,
+									 const float *row,
+									 const uint64_t *wins)
+{
+	const unsigned cols = data.num_cols, cols_vec = cols - cols % LANES;
+	float sum[LANES] = {}, worst[LANES];
+	std::fill(worst, worst + LANES, std::numeric_limits<float>::infinity());
+	for (unsigned c = 0; c < cols_vec; c += LANES)
+	{
+		for (unsigned l = 0; l < LANES; ++l)
+		{
+			float v = std::max(pair_max[c + l], row[c + l]);
+			sum[l] += v;
+			worst[l] = std::min(worst[l], v);
+		}
+	}
+	for (unsigned c = cols_vec; c < cols; ++c)
+	{
+		float v = std::max(pair_max[c], row[c]);
+		sum[0] += v;
+		worst[0] = std::min(worst[0], v);
+	}
+	float total = 0, team_worst = worst[0];
+	for (unsigned l = 0; l < LANES; ++l)
+	{
+		total += sum[l];
+		team_worst = std::min(team_worst, worst[l]);
+	}
+	unsigned coverage = 0;
+	for (unsigned w = 0; w < data.num_words; ++w)
+	{
+		coverage += __builtin_popcountll(pair_wins[w] | wins[w]);
+	}
+
+	TeamCandidate cand;
+	switch (data.options.objective)
+	{
+	case TeamObjective::Worst:
+		cand.key = team_worst;
+		cand.tiebreak = total;
+		break;
+	case TeamObjective::Coverage:
+		cand.key = coverage;
+		cand.tiebreak = total;
+		break;
+	default:
+		cand.key = total;
+		cand.tiebreak = team_worst;
+		break;
+	}
+	return cand;
+}
+
+static void search_worker(const TeamSearchData &data, std::atomic<unsigned> &next_first, std::vector<TeamCandidate> &heap)
+{
+	const unsigned n = data.num_rows, cols = data.num_cols, words = data.num_words;
+	const unsigned top_k = data.options.top_k;
+	std::vector<float> pair_max(cols);
+	std::vector<uint64_t> pair_wins(words);
+
+	for (unsigned a = next_first++; a < n; a = next_first++)
+	{
+		// bound for every team starting with a
+		if (heap.size() == top_k &&
+			score_candidate(data, data.row(a), data.row_wins(a), data.suffix_row(a + 1), data.suffix_row_wins(a + 1)).key < heap.front().key)
+		{
+			continue;
+		}
+		for (unsigned b = a + 1; b < n; ++b)
+		{
+			const float *row_a = data.row(a), *row_b = data.row(b);
+			for (unsigned c = 0; c < cols; ++c)
+			{
+				pair_max[c] = std::max(row_a[c], row_b[c]);
+			}
+			const uint64_t *wins_a = data.row_wins(a), *wins_b = data.row_wins(b);
+			for (unsigned w = 0; w < words; ++w)
+			{
+				pair_wins[w] = wins_a[w] | wins_b[w];
+			}
+
+			// bound for every team starting with (a, b)
+			if (heap.size() == top_k &&
+				score_candidate(data, pair_max.data(), pair_wins.data(), data.suffix_row(b + 1), data.suffix_row_wins(b + 1)).key < heap.front().key)
+			{
+				continue;
+			}
+
+			for (unsigned d = b + 1; d < n; ++d)
+			{
+				auto cand = score_candidate(data, pair_max.data(), pair_wins.data(), data.row(d), data.row_wins(d));
+				cand.members[0] = a;
+				cand.members[1] = b;
+				cand.members[2] = d;
+
+				if (heap.size() < top_k)
+				{
+					heap.push_back(cand);
+					std::push_heap(heap.begin(), heap.end(), is_better);
+				}
+				else if (is_better(cand, heap.front()))
+				{
+					std::pop_heap(heap.begin(), heap.end(), is_better);
+					heap.back() = cand;
+					std::push_heap(heap.begin(), heap.end(), is_better);
+				}
+			}
+		}
+	}
+}
+
+static TeamScore score_team(const Matrix_t &matrix, const unsigned *members, double threshold)
+{
+	TeamScore team;
+	std::copy(members, members + TEAM_SIZE, team.members);
+	unsigned num_cols = matrix[members[0]].size();
+	team.worst = num_cols > 0 ? std::numeric_limits<double>::infinity() : 0.0;
+	for (unsigned c = 0; c < num_cols; ++c)
+	{
+		double best = matrix[members[0]][c];
+		for (unsigned m = 1; m < TEAM_SIZE; ++m)
+		{
+			best = std::max(best, matrix[members[m]][c]);
+		}
+		team.average += best;
+		team.worst = std::min(team.worst, best);
+		team.coverage += best > threshold;
+	}
+	team.average = num_cols > 0 ? team.average / num_cols : 0.0;
+	return team;
+}
+
+std::vector<TeamScore> search_teams(const Matrix_t &matrix, const TeamSearchOptions &options)
+{
+	TeamSearchData data;
+	data.options = options;
+	data.num_rows = matrix.size();
+	data.num_cols = data.num_rows > 0 ? matrix[0].size() : 0;
+	data.num_words = (data.num_cols + 63) / 64;
+	if (data.num_rows < TEAM_SIZE || options.top_k == 0)
+	{
+		return {};
+	}
+
+	data.scores.resize(static_cast<size_t>(data.num_rows) * data.num_cols);
+	data.wins.assign(static_cast<size_t>(data.num_rows) * data.num_words, 0);
+	for (unsigned i = 0; i < data.num_rows; ++i)
+	{
+		for (unsigned c = 0; c < data.num_cols; ++c)
+		{
+			data.scores[static_cast<size_t>(i) * data.num_cols + c] = matrix[i][c];
+			if (matrix[i][c] > options.threshold)
+			{
+				data.wins[static_cast<size_t>(i) * data.num_words + c / 64] |= uint64_t(1) << (c % 64);
+			}
+		}
+	}
+
+	// suffix bounds; the last one (past the end) never beats anything
+	data.suffix_scores.assign(static_cast<size_t>(data.num_rows + 1) * data.num_cols, -std::numeric_limits<float>::infinity());
+	data.suffix_wins.assign(static_cast<size_t>(data.num_rows + 1) * data.num_words, 0);
+	for (unsigned i = data.num_rows; i-- > 0;)
+	{
+		for (unsigned c = 0; c < data.num_cols; ++c)
+		{
+			data.suffix_scores[static_cast<size_t>(i) * data.num_cols + c] = std::max(data.row(i)[c], data.suffix_row(i + 1)[c]);
+		}
+		for (unsigned w = 0; w < data.num_words; ++w)
+		{
+			data.suffix_wins[static_cast<size_t>(i) * data.num_words + w] = data.row_wins(i)[w] | data.suffix_row_wins(i + 1)[w];
+		}
+	}
+
+	std::atomic<unsigned> next_first(0);
+#ifndef __EMSCRIPTEN__
+	unsigned cpu_count = std::thread::hardware_concurrency();
+	cpu_count = cpu_count > 0 ? cpu_count : 1;
+	std::vector<std::vector<TeamCandidate>> heaps(cpu_count);
+	std::vector<std::thread> threads(cpu_count);
+	for (unsigned i = 0; i < cpu_count; ++i)
+	{
+		threads[i] = std::thread(search_worker, std::cref(data), std::ref(next_first), std::ref(heaps[i]));
+	}
+	for (unsigned i = 0; i < cpu_count; ++i)
+	{
+		threads[i].join();
+	}
+#else
+	std::vector<std::vector<TeamCandidate>> heaps(1);
+	search_worker(data, next_first, heaps[0]);
+#endif
+
+	std::vector<TeamCandidate> candidates;
+	for (const auto &heap : heaps)
+	{
+		candidates.insert(candidates.end(), heap.begin(), heap.end());
+	}
+	std::sort(candidates.begin(), candidates.end(), is_better);
+	if (candidates.size() > options.top_k)
+	{
+		candidates.resize(options.top_k);
+	}
+
+	std::vector<TeamScore> teams;
+	for (const auto &cand : candidates)
+	{
+		teams.push_back(score_team(matrix, cand.members, options.threshold));
+	}
+	return teams;
+}
+
+} // namespace GoBattleSim
@@ -0,0 +1,139 @@
+#include "TraceWriter.h"
+
+#include "GameMaster.h"
+
+#include <stdio.h>
+#include <stdexcept>
+
+namespace GoBattleSim
+{
+
+static std::string escape(const std::string &str)
+{
+	std::string out;
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+		}
+		out += c;
+	}
+	return out;
+}
+
+void TraceWriter::reset(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_enabled = enabled;
+	m_origin = std::chrono::steady_clock::now();
+	m_events.clear();
+#ifndef __EMSCRIPTEN__
+	m_thread_tracks.clear();
+#endif
+}
+
+bool TraceWriter::enabled() const
+{
+	return m_enabled;
+}
+
+void TraceWriter::set_origin(std::chrono::steady_clock::time_point origin)
+{
+	m_origin = origin;
+}
+
+double TraceWriter::now() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_origin).count();
+}
+
+unsigned TraceWriter::thread_track()
+{
+#ifndef __EMSCRIPTEN__
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_thread_tracks.emplace(std::this_thread::get_id(), m_thread_tracks.size()).first;
+	return it->second;
+#else
+	return 0;
+#endif
+}
+
+void TraceWriter::add_span(const std::string &name, const char *category, unsigned pid, unsigned tid, double ts, double dur,
+						   const std::string &args)
+{
+	char buf[128];
+	snprintf(buf, sizeof(buf), "\"ph\": \"X\", \"pid\": %u, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f", pid, tid, ts, dur);
+	add("{\"name\": \"" + escape(name) + "\", \"cat\": \"" + category + "\", " + buf +
+		(args.empty() ? "" : ", \"args\": " + args) + "}");
+}
+
+void TraceWriter::add_instant(const std::string &name, const char *category, unsigned pid, unsigned tid, double ts,
+							  const std::string &args)
+{
+	char buf[128];
+	snprintf(buf, sizeof(buf), "\"ph\": \"i\", \"s\": \"t\", \"pid\": %u, \"tid\": %u, \"ts\": %.3f", pid, tid, ts);
+	add("{\"name\": \"" + escape(name) + "\", \"cat\": \"" + category + "\", " + buf +
+		(args.empty() ? "" : ", \"args\": " + args) + "}");
+}
+
+void TraceWriter::name_process(unsigned pid, const std::string &name)
+{
+	add("{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " + std::to_string(pid) +
+		", \"args\": {\"name\": \"" + escape(name) + "\"}}");
+}
+
+void TraceWriter::name_track(unsigned pid, unsigned tid, const std::string &name)
+{
+	add("{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " + std::to_string(pid) + ", \"tid\": " + std::to_string(tid) +
+		", \"args\": {\"name\": \"" + escape(name) + "\"}}");
+}
+
+void TraceWriter::add(std::string &&event)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events.push_back(std::move(event));
+}
+
+void TraceWriter::write(const std::string &path) const
+{
+	FILE *file = fopen(path.c_str(), "w");
+	if (file == nullptr)
+	{
+		snprintf(err_msg, sizeof(err_msg), "cannot open %s for writing", path.c_str());
+		throw std::runtime_error(err_msg);
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n", file);
+	for (size_t i = 0; i < m_events.size(); ++i)
+	{
+		fputs(m_events[i].c_str(), file);
+		fputs(i + 1 < m_events.size() ? ",\n" : "\n", file);
+	}
+	fputs("]}\n", file);
+	if (fclose(file) != 0)
+	{
+		snprintf(err_msg, sizeof(err_msg), "cannot write %s", path.c_str());
+		throw std::runtime_error(err_msg);
+	}
+}
+
+TraceSpan::TraceSpan(TraceWriter *trace, const char *name, long index)
+	: m_trace(trace != nullptr && trace->enabled() ? trace : nullptr), m_name(name), m_index(index)
+{
+	if (m_trace != nullptr)
+	{
+		m_start = m_trace->now();
+	}
+}
+
+TraceSpan::~TraceSpan()
+{
+	if (m_trace != nullptr)
+	{
+		m_trace->add_span(m_name, "engine", 0, m_trace->thread_track(), m_start, m_trace->now() - m_start,
+						  m_index >= 0 ? "{\"index\": " + std::to_string(m_index) + "}" : std::string());
+	}
+}
+
+} // namespace GoBattleSim
@@ -0,0 +1,433 @@
+#include "WorkloadGenerator.h"
+
+#include "GameMaster.h"
+#include "Pokemon.h"
+
+#include "json.hpp"
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <random>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace GoBattleSim
+{
+
+using nlohmann::json;
+
+/**
+ * Draws from std::mt19937_64 by hand, since the standard distributions may differ between libraries
+ * and the workload should not.
+ */
+class WorkloadRandom
+{
+public:
+	explicit WorkloadRandom(unsigned long seed) : m_engine(seed)
+	{
+	}
+
+	// in [0, n)
+	unsigned uniform(unsigned n)
+	{
+		return static_cast<unsigned>(m_engine() % n);
+	}
+
+	// in [first, last]
+	int uniform(int first, int last)
+	{
+		return first + static_cast<int>(uniform(static_cast<unsigned>(last - first + 1)));
+	}
+
+	// in [0, 1)
+	double unit()
+	{
+		return (m_engine() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// index i with chance weights[i] / sum(weights)
+	unsigned weighted(const double *weights, unsigned n)
+	{
+		double sum = 0;
+		for (unsigned i = 0; i < n; ++i)
+		{
+			sum += weights[i];
+		}
+		double x = unit() * sum;
+		for (unsigned i = 0; i + 1 < n; ++i)
+		{
+			if (x < weights[i])
+			{
+				return i;
+			}
+			x -= weights[i];
+		}
+		return n - 1;
+	}
+
+	template <class T>
+	const T &pick(const std::vector<T> &items)
+	{
+		return items[uniform(items.size())];
+	}
+
+private:
+	std::mt19937_64 m_engine;
+};
+
+/**
+ * The species and moves of a game master that inputs are sampled from.
+ */
+class WorkloadSampler
+{
+public:
+	WorkloadSampler(const json &gm, unsigned long seed) : m_random(seed)
+	{
+		for (const char *key : {"Pokemon", "PvEMoves", "PvPMoves", "CPMultipliers", "RaidTierSettings"})
+		{
+			if (!gm.contains(key))
+			{
+				sprintf(err_msg, "game master has no %s", key);
+				throw std::runtime_error(err_msg);
+			}
+		}
+		gm["CPMultipliers"].get_to(m_cpms);
+		m_raid_tiers = gm["RaidTierSettings"].get<std::vector<json>>();
+		read_moves(gm["PvEMoves"], m_pve_moves);
+		read_moves(gm["PvPMoves"], m_pvp_moves);
+		for (const auto &species : gm["Pokemon"])
+		{
+			if (has_moves(species, m_pve_moves))
+			{
+				m_pve_species.push_back(species);
+			}
+			if (has_moves(species, m_pvp_moves))
+			{
+				m_pvp_species.push_back(species);
+			}
+		}
+		if (m_cpms.empty() || m_raid_tiers.empty() || m_pve_species.empty() || m_pvp_species.empty())
+		{
+			sprintf(err_msg, "game master has no Pokemon with known moves, CP multipliers or raid tiers");
+			throw std::runtime_error(err_msg);
+		}
+		auto weathers = gm.value("WeatherSettings", json::object());
+		for (auto it = weathers.begin(); it != weathers.end(); ++it)
+		{
+			m_weathers.push_back(it.key());
+		}
+	}
+
+	json raid(unsigned size)
+	{
+		static const unsigned max_players[NUM_WORKLOAD_SIZES] = {1, 5, 20};
+		const auto &tier = m_random.pick(m_raid_tiers);
+		double cpm = tier.at("cpm").get<double>();
+		auto boss = pve_pokemon(m_random.pick(m_pve_species), cpm, 15);
+		boss["maxHP"] = tier.at("maxHP");
+		boss["strategy"] = "DEFENDER";
+
+		json input = pve_input("raid", tier.at("timelimit").get<int>(), size);
+		input["players"].push_back(defender_player({boss}));
+		unsigned num_players = m_random.uniform(size > 0 ? max_players[size - 1] + 1 : 1, max_players[size]);
+		for (unsigned i = 0; i < num_players; ++i)
+		{
+			input["players"].push_back(attacker_player());
+		}
+		return input;
+	}
+
+	json gym(unsigned size)
+	{
+		static const unsigned max_defenders[NUM_WORKLOAD_SIZES] = {2, 4, 6};
+		unsigned num_defenders = m_random.uniform(size > 0 ? max_defenders[size - 1] + 1 : 1, max_defenders[size]);
+		std::vector<json> defenders;
+		for (unsigned i = 0; i < num_defenders; ++i)
+		{
+			auto level = attacker_level();
+			auto defender = pve_pokemon(m_random.pick(m_pve_species), cpm(level), m_random.uniform(10, 15));
+			defender["strategy"] = "DEFENDER";
+			defenders.push_back(defender);
+		}
+
+		json input = pve_input("gym", 100000, size);
+		input["players"].push_back(defender_player(defenders));
+		input["players"].push_back(attacker_player());
+		return input;
+	}
+
+	json pvp(unsigned size)
+	{
+		static const unsigned num_sims[NUM_WORKLOAD_SIZES] = {1, 10, 100};
+		json input;
+		input["battleMode"] = "pvp";
+		input["timelimit"] = 480;
+		input["numSims"] = num_sims[size];
+		input["aggregation"] = "enum";
+		input["enableLog"] = false;
+		input["seed"] = seed();
+		input["pokemon"] = {pvp_pokemon(), pvp_pokemon()};
+		input["strategies"] = {pvp_strategy(), pvp_strategy()};
+		input["numShields"] = {m_random.uniform(0, 2), m_random.uniform(0, 2)};
+		return input;
+	}
+
+	json battle_matrix(unsigned size)
+	{
+		static const unsigned max_count[NUM_WORKLOAD_SIZES] = {10, 40, 100};
+		auto count = [&]() {
+			return m_random.uniform(size > 0 ? max_count[size - 1] + 1 : 2, max_count[size]);
+		};
+		json input;
+		input["battleMode"] = "battlematrix";
+		input["seed"] = seed();
+		input["rowPokemon"] = json::array();
+		input["colPokemon"] = json::array();
+		for (unsigned i = 0, n = count(); i < n; ++i)
+		{
+			input["rowPokemon"].push_back(pvp_pokemon());
+		}
+		// half of the matrices are square, against the row Pokemon
+		if (m_random.uniform(2) == 0)
+		{
+			for (unsigned i = 0, n = count(); i < n; ++i)
+			{
+				input["colPokemon"].push_back(pvp_pokemon());
+			}
+		}
+		return input;
+	}
+
+	unsigned mode(const double *weights)
+	{
+		return m_random.weighted(weights, NUM_WORKLOAD_MODES);
+	}
+
+	unsigned size(const double *weights)
+	{
+		return m_random.weighted(weights, NUM_WORKLOAD_SIZES);
+	}
+
+private:
+	static void read_moves(const json &moves_j, std::map<std::string, json> &moves)
+	{
+		for (auto move : moves_j)
+		{
+			move.erase("movetype");
+			moves[move.at("name").get<std::string>()] = move;
+		}
+	}
+
+	static bool has_moves(const json &species, const std::map<std::string, json> &moves)
+	{
+		auto known = [&](const char *key) {
+			for (const auto &name : species.value(key, json::array()))
+			{
+				if (moves.count(name.get<std::string>()) > 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+		return known("fastMoves") && known("chargedMoves");
+	}
+
+	unsigned seed()
+	{
+		return m_random.uniform(0x7fffffffu);
+	}
+
+	double cpm(double level)
+	{
+		auto idx = std::min(static_cast<size_t>((level - 1) * 2), m_cpms.size() - 1);
+		return m_cpms[idx];
+	}
+
+	// most attackers are maxed out, the rest are spread over levels 20 to 39.5
+	double attacker_level()
+	{
+		return m_random.uniform(5) < 2 ? 40 : m_random.uniform(40, 79) / 2.0;
+	}
+
+	/**
+	 * @param species with types, stats from @param cpm and IVs of @param iv, and random moves of @param moves.
+	 */
+	json pokemon(const json &species, double cpm, int iv, const std::map<std::string, json> &moves,
+				 unsigned max_cmoves)
+	{
+		auto known = [&](const char *key) {
+			std::vector<std::string> names;
+			for (const auto &name : species.at(key))
+			{
+				if (moves.count(name.get<std::string>()) > 0)
+				{
+					names.push_back(name.get<std::string>());
+				}
+			}
+			return names;
+		};
+
+		json pkm;
+		pkm["name"] = species.at("name");
+		pkm["pokeType1"] = species.value("pokeType1", "none");
+		pkm["pokeType2"] = species.value("pokeType2", "none");
+		pkm["attack"] = (species.at("baseAtk").get<int>() + iv) * cpm;
+		pkm["defense"] = (species.at("baseDef").get<int>() + iv) * cpm;
+		pkm["maxHP"] = calc_max_hp(species.at("baseStm").get<int>(), iv, cpm);
+		pkm["startingEnergy"] = 0;
+		pkm["fmove"] = moves.at(m_random.pick(known("fastMoves")));
+		auto cmove_names = known("chargedMoves");
+		unsigned num_cmoves = std::min<unsigned>(cmove_names.size(), m_random.uniform(1, max_cmoves));
+		pkm["cmoves"] = json::array();
+		for (unsigned i = 0; i < num_cmoves; ++i)
+		{
+			unsigned k = i + m_random.uniform(cmove_names.size() - i);
+			std::swap(cmove_names[i], cmove_names[k]);
+			pkm["cmoves"].push_back(moves.at(cmove_names[i]));
+		}
+		return pkm;
+	}
+
+	json pve_pokemon(const json &species, double cpm, int iv)
+	{
+		return pokemon(species, cpm, iv, m_pve_moves, 1);
+	}
+
+	// PvP Pokemon are not maxed out, but kept under league caps, so levels and IVs are spread wide
+	json pvp_pokemon()
+	{
+		auto level = m_random.uniform(20, 80) / 2.0;
+		return pokemon(m_random.pick(m_pvp_species), cpm(level), m_random.uniform(0, 15), m_pvp_moves, 2);
+	}
+
+	const char *pvp_strategy()
+	{
+		return m_random.uniform(2) == 0 ? "PVP_BASIC" : "PVP_ADVANCE";
+	}
+
+	json pve_input(const char *mode, int time_limit, unsigned size)
+	{
+		static const unsigned num_sims[NUM_WORKLOAD_SIZES] = {10, 25, 50};
+		json input;
+		input["battleMode"] = mode;
+		input["timelimit"] = time_limit;
+		if (!m_weathers.empty())
+		{
+			input["weather"] = m_random.pick(m_weathers);
+		}
+		input["numSims"] = num_sims[size];
+		input["aggregation"] = "avrg";
+		input["enableLog"] = false;
+		input["seed"] = seed();
+		input["players"] = json::array();
+		return input;
+	}
+
+	json defender_player(const std::vector<json> &pokemon)
+	{
+		json party;
+		party["pokemon"] = pokemon;
+		json player;
+		player["team"] = 0;
+		player["parties"] = {party};
+		return player;
+	}
+
+	// a party of six, of one to three species
+	json attacker_player()
+	{
+		static const char *strategies[] = {"ATTACKER_NO_DODGE", "ATTACKER_DODGE_CHARGED", "ATTACKER_DODGE_ALL"};
+		auto strategy = strategies[m_random.uniform(3)];
+		json party;
+		party["revive"] = m_random.uniform(2) == 0;
+		party["pokemon"] = json::array();
+		unsigned num_species = m_random.uniform(1, 3), num_left = 6;
+		for (unsigned i = 0; i < num_species; ++i)
+		{
+			unsigned copies = i + 1 < num_species ? m_random.uniform(1, num_left - (num_species - i - 1)) : num_left;
+			num_left -= copies;
+			auto pkm = pve_pokemon(m_random.pick(m_pve_species), cpm(attacker_level()), m_random.uniform(10, 15));
+			pkm["copies"] = copies;
+			pkm["strategy"] = strategy;
+			party["pokemon"].push_back(pkm);
+		}
+		json player;
+		player["team"] = 1;
+		player["parties"] = {party};
+		return player;
+	}
+
+	WorkloadRandom m_random;
+	std::vector<double> m_cpms;
+	std::vector<json> m_raid_tiers;
+	std::vector<std::string> m_weathers;
+	std::map<std::string, json> m_pve_moves;
+	std::map<std::string, json> m_pvp_moves;
+	std::vector<json> m_pve_species;
+	std::vector<json> m_pvp_species;
+};
+
+void parse_workload_weights(const std::string &spec, const std::vector<std::string> &names, double *weights)
+{
+	std::fill(weights, weights + names.size(), 0.0);
+	size_t first = 0;
+	while (first < spec.size())
+	{
+		auto last = spec.find(',', first);
+		auto item = spec.substr(first, last == std::string::npos ? std::string::npos : last - first);
+		first = last == std::string::npos ? spec.size() : last + 1;
+
+		auto colon = item.find(':');
+		auto name = item.substr(0, colon);
+		auto found = std::find(names.begin(), names.end(), name);
+		double weight = colon == std::string::npos ? 1.0 : atof(item.c_str() + colon + 1);
+		if (found == names.end() || weight < 0)
+		{
+			snprintf(err_msg, sizeof(err_msg), "bad workload weight: %s", item.c_str());
+			throw std::runtime_error(err_msg);
+		}
+		weights[found - names.begin()] = weight;
+	}
+}
+
+std::vector<std::string> generate_workload(const std::string &game_master, const WorkloadOptions &options)
+{
+	auto positive = [](double weight) { return weight > 0; };
+	if (std::none_of(options.mode_weights, options.mode_weights + NUM_WORKLOAD_MODES, positive) ||
+		std::none_of(options.size_weights, options.size_weights + NUM_WORKLOAD_SIZES, positive))
+	{
+		sprintf(err_msg, "workload needs a battle mode and a size with positive weights");
+		throw std::runtime_error(err_msg);
+	}
+	WorkloadSampler sampler(json::parse(game_master), options.seed);
+	std::vector<std::string> inputs;
+	inputs.reserve(options.num_inputs);
+	for (unsigned i = 0; i < options.num_inputs; ++i)
+	{
+		auto mode = sampler.mode(options.mode_weights);
+		auto size = sampler.size(options.size_weights);
+		json input;
+		switch (mode)
+		{
+		case 0:
+			input = sampler.raid(size);
+			break;
+		case 1:
+			input = sampler.gym(size);
+			break;
+		case 2:
+			input = sampler.pvp(size);
+			break;
+		default:
+			input = sampler.battle_matrix(size);
+			break;
+		}
+		inputs.push_back(input.dump());
+	}
+	return inputs;
+}
+
+} // namespace GoBattleSim
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "GameMaster.h"
+#include "Move.h"
+#include "Pokemon.h"
+
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GoBattleSim
+{
+
+struct SpeciesEntry
+{
+    int poketype1{-1};
+    int poketype2{-1};
+    int base_atk{0};
+    int base_def{0};
+    int base_stm{0};
+};
+
+struct StatBlock
+{
+    double attack{0};
+    double defense{0};
+    int max_hp{0};
+};
+
+/**
+ * Species, moves and CP multipliers of the game master, by name, so that inputs can refer to them.
+ * Copies share the tables (which are not changed after they are built) and the cache of stat blocks.
+ */
+class Catalog
+{
+public:
+    /**
+     * the catalog bound to the calling thread, or the global one if none is bound.
+     */
+    static Catalog &get()
+    {
+        return bound != nullptr ? *bound : instance;
+    }
+
+    /**
+     * bind @param catalog to the calling thread (NULL for the global one), and return the previous one.
+     */
+    static Catalog *bind(Catalog *catalog)
+    {
+        auto prev = bound;
+        bound = catalog;
+        return prev;
+    }
+
+    Catalog() : m_tables(std::make_shared<Tables>()), m_stat_cache(std::make_shared<StatCache>())
+    {
+    }
+
+    /**
+     * start new tables, leaving the old ones to the copies still using them
+     */
+    void reset()
+    {
+        m_tables = std::make_shared<Tables>();
+        m_stat_cache = std::make_shared<StatCache>();
+    }
+
+    void set_cp_multipliers(const std::vector<double> &cpms)
+    {
+        m_tables->cpms = cpms;
+    }
+
+    const std::vector<double> &cp_multipliers() const
+    {
+        return m_tables->cpms;
+    }
+
+    /**
+     * add a species, unless one of the same name is already there
+     */
+    void add_species(const std::string &name, const SpeciesEntry &entry)
+    {
+        if (m_tables->species_index.emplace(name, m_tables->species.size()).second)
+        {
+            m_tables->species.push_back(entry);
+            m_tables->species_names.push_back(name);
+        }
+    }
+
+    void add_move(const std::string &name, bool pvp, const Move &move)
+    {
+        (pvp ? m_tables->pvp_moves : m_tables->pve_moves).emplace(name, move);
+    }
+
+    unsigned num_species() const
+    {
+        return m_tables->species.size();
+    }
+
+    const std::string &species_name(unsigned idx) const
+    {
+        return m_tables->species_names[idx];
+    }
+
+    const SpeciesEntry &species(unsigned idx) const
+    {
+        return m_tables->species[idx];
+    }
+
+    const std::unordered_map<std::string, Move> &moves(bool pvp) const
+    {
+        return pvp ? m_tables->pvp_moves : m_tables->pve_moves;
+    }
+
+    /**
+     * @return index of species @param name, or -1 if there is none
+     */
+    int find_species(const std::string &name) const
+    {
+        auto it = m_tables->species_index.find(name);
+        return it != m_tables->species_index.end() ? static_cast<int>(it->second) : -1;
+    }
+
+    /**
+     * @return PvP (if @param pvp) or PvE move @param name, or NULL if there is none
+     */
+    const Move *find_move(const std::string &name, bool pvp) const
+    {
+        const auto &moves = pvp ? m_tables->pvp_moves : m_tables->pve_moves;
+        auto it = moves.find(name);
+        return it != moves.end() ? &it->second : nullptr;
+    }
+
+    /**
+     * stats of species @param idx at @param level (a multiple of 0.5) with @param ivs (attack, defense, stamina)
+     */
+    StatBlock stats(unsigned idx, double level, const int ivs[3]) const
+    {
+        int level_idx = static_cast<int>(lround((level - 1) * 2));
+        if (level_idx < 0 || level_idx >= static_cast<int>(m_tables->cpms.size()) || level_idx != (level - 1) * 2)
+        {
+            sprintf(err_msg, "bad level: %g (max %g)", level, 1 + (m_tables->cpms.size() - 1) * 0.5);
+            throw std::runtime_error(err_msg);
+        }
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            if (ivs[i] < 0 || ivs[i] > 15)
+            {
+                sprintf(err_msg, "bad IV: %d (must be 0 to 15)", ivs[i]);
+                throw std::runtime_error(err_msg);
+            }
+        }
+
+        uint64_t key = (static_cast<uint64_t>(idx) << 20) | (level_idx << 12) | (ivs[0] << 8) | (ivs[1] << 4) | ivs[2];
+        std::lock_guard<std::mutex> lock(m_stat_cache->mutex);
+        auto it = m_stat_cache->blocks.find(key);
+        if (it != m_stat_cache->blocks.end())
+        {
+            return it->second;
+        }
+        const auto &entry = m_tables->species[idx];
+        double cpm = m_tables->cpms[level_idx];
+        StatBlock block;
+        block.attack = (entry.base_atk + ivs[0]) * cpm;
+        block.defense = (entry.base_def + ivs[1]) * cpm;
+        block.max_hp = calc_max_hp(entry.base_stm, ivs[2], cpm);
+        if (m_stat_cache->blocks.size() >= MAX_NUM_STAT_BLOCKS)
+        {
+            m_stat_cache->blocks.clear();
+        }
+        m_stat_cache->blocks.emplace(key, block);
+        return block;
+    }
+
+private:
+    static Catalog instance;
+    static thread_local Catalog *bound;
+
+    static constexpr size_t MAX_NUM_STAT_BLOCKS = 1 << 16;
+
+    struct Tables
+    {
+        std::vector<double> cpms;
+        std::vector<SpeciesEntry> species;
+        std::vector<std::string> species_names;
+        std::unordered_map<std::string, unsigned> species_index;
+        std::unordered_map<std::string, Move> pve_moves;
+        std::unordered_map<std::string, Move> pvp_moves;
+    };
+
+    struct StatCache
+    {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, StatBlock> blocks;
+    };
+
+    std::shared_ptr<Tables> m_tables;
+    std::shared_ptr<StatCache> m_stat_cache;
+};
+
+Catalog Catalog::instance;
+thread_local Catalog *Catalog::bound = nullptr;
+constexpr size_t Catalog::MAX_NUM_STAT_BLOCKS;
+
+} // namespace GoBattleSim
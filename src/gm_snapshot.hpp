@@ -0,0 +1,336 @@
+/**
+ * Binary snapshot of a resolved game master, its name mappings and its catalog, loaded without parsing JSON.
+ *
+ * Layout: a SnapshotHeader, the GameMaster object as is, then the tables:
+ * the type names and the weather names, each as (int32 index, string),
+ * the CP multipliers as doubles, the species as (string, SpeciesEntry), and the PvE then PvP moves as (string, Move).
+ * A string is a uint32 length and the characters. The snapshot is only valid for the same build,
+ * whose version the header records and checks, so it is meant to be compiled by the gbs binary that loads it.
+ */
+
+#pragma once
+
+#include "GameMaster.h"
+#include "name_mapping.hpp"
+#include "catalog.hpp"
+#include "config.h"
+
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GoBattleSim
+{
+
+static_assert(std::is_trivially_copyable<GameMaster>::value, "GameMaster is copied into snapshots as bytes");
+static_assert(std::is_trivially_copyable<SpeciesEntry>::value, "SpeciesEntry is copied into snapshots as bytes");
+static_assert(std::is_trivially_copyable<Move>::value, "Move is copied into snapshots as bytes");
+
+constexpr char SNAPSHOT_MAGIC[4] = {'G', 'B', 'S', 'G'};
+constexpr uint32_t SNAPSHOT_VERSION = 4;
+
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    // sizes of the objects copied as bytes, so that a layout change is rejected even within a build
+    uint32_t game_master_size;
+    uint32_t move_size;
+    uint32_t species_size;
+    uint32_t num_type_names;
+    uint32_t num_weather_names;
+    uint32_t num_cp_multipliers;
+    uint32_t num_species;
+    uint32_t num_pve_moves;
+    uint32_t num_pvp_moves;
+    uint32_t tables_size;
+    // hash of the game master JSON the snapshot was compiled from
+    char fingerprint[32];
+    // PROJECT_GIT_VERSION of the build that compiled the snapshot, as the object layouts may differ between builds
+    char build[32];
+};
+
+template <class T>
+void append_pod(std::string &out, const T &value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+inline void append_string(std::string &out, const std::string &str)
+{
+    append_pod(out, static_cast<uint32_t>(str.size()));
+    out.append(str);
+}
+
+inline void append_names(std::string &out, const NameMapping &mapping)
+{
+    for (const auto &kv : mapping.names())
+    {
+        append_pod(out, static_cast<int32_t>(kv.first));
+        append_string(out, kv.second);
+    }
+}
+
+inline void append_moves(std::string &out, const std::unordered_map<std::string, Move> &moves)
+{
+    for (const auto &kv : moves)
+    {
+        append_string(out, kv.first);
+        append_pod(out, kv.second);
+    }
+}
+
+inline void write_snapshot(const std::string &path,
+                           const GameMaster &gm,
+                           const PokeTypeMapping &poketype_mapping,
+                           const WeatherMapping &weather_mapping,
+                           const Catalog &catalog,
+                           const std::string &fingerprint)
+{
+    std::string tables;
+    append_names(tables, poketype_mapping);
+    append_names(tables, weather_mapping);
+    for (auto cpm : catalog.cp_multipliers())
+    {
+        append_pod(tables, cpm);
+    }
+    for (unsigned i = 0; i < catalog.num_species(); ++i)
+    {
+        append_string(tables, catalog.species_name(i));
+        append_pod(tables, catalog.species(i));
+    }
+    append_moves(tables, catalog.moves(false));
+    append_moves(tables, catalog.moves(true));
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.game_master_size = sizeof(GameMaster);
+    header.move_size = sizeof(Move);
+    header.species_size = sizeof(SpeciesEntry);
+    header.num_type_names = poketype_mapping.names().size();
+    header.num_weather_names = weather_mapping.names().size();
+    header.num_cp_multipliers = catalog.cp_multipliers().size();
+    header.num_species = catalog.num_species();
+    header.num_pve_moves = catalog.moves(false).size();
+    header.num_pvp_moves = catalog.moves(true).size();
+    header.tables_size = tables.size();
+    memcpy(header.fingerprint, fingerprint.data(), std::min(fingerprint.size(), sizeof(header.fingerprint)));
+    strncpy(header.build, PROJECT_GIT_VERSION, sizeof(header.build) - 1);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        snprintf(err_msg, sizeof(err_msg), "cannot open %s for writing", path.c_str());
+        throw std::runtime_error(err_msg);
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(&gm, sizeof(GameMaster), 1, file) == 1 &&
+              fwrite(tables.data(), 1, tables.size(), file) == tables.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        snprintf(err_msg, sizeof(err_msg), "cannot write %s", path.c_str());
+        throw std::runtime_error(err_msg);
+    }
+}
+
+/**
+ * Reads the tables of a snapshot, and fails on reading past the end.
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(const char *first, const char *last) : m_cur(first), m_last(last)
+    {
+    }
+
+    template <class T>
+    T read_pod()
+    {
+        T value;
+        check(sizeof(T));
+        memcpy(static_cast<void *>(&value), m_cur, sizeof(T));
+        m_cur += sizeof(T);
+        return value;
+    }
+
+    std::string read_string()
+    {
+        auto len = read_pod<uint32_t>();
+        check(len);
+        std::string str(m_cur, len);
+        m_cur += len;
+        return str;
+    }
+
+    void read_names(uint32_t num_names, NameMapping &mapping)
+    {
+        mapping.reset();
+        for (uint32_t i = 0; i < num_names; ++i)
+        {
+            auto idx = read_pod<int32_t>();
+            mapping.map(idx, read_string());
+        }
+    }
+
+    void read_moves(uint32_t num_moves, bool pvp, Catalog &catalog)
+    {
+        for (uint32_t i = 0; i < num_moves; ++i)
+        {
+            auto name = read_string();
+            catalog.add_move(name, pvp, read_pod<Move>());
+        }
+    }
+
+    bool at_end() const
+    {
+        return m_cur == m_last;
+    }
+
+private:
+    void check(size_t size) const
+    {
+        if (static_cast<size_t>(m_last - m_cur) < size)
+        {
+            sprintf(err_msg, "corrupted game master snapshot");
+            throw std::runtime_error(err_msg);
+        }
+    }
+
+    const char *m_cur;
+    const char *m_last;
+};
+
+/**
+ * Load a snapshot of @param size bytes at @param data. Nothing is changed if it is invalid.
+ */
+inline void read_snapshot(const char *data,
+                          size_t size,
+                          GameMaster &gm,
+                          PokeTypeMapping &poketype_mapping,
+                          WeatherMapping &weather_mapping,
+                          Catalog &catalog,
+                          std::string &fingerprint)
+{
+    SnapshotHeader header;
+    if (size < sizeof(header) || memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+    {
+        sprintf(err_msg, "not a game master snapshot");
+        throw std::runtime_error(err_msg);
+    }
+    memcpy(&header, data, sizeof(header));
+    header.build[sizeof(header.build) - 1] = '\0';
+    if (header.version != SNAPSHOT_VERSION || header.game_master_size != sizeof(GameMaster) ||
+        header.move_size != sizeof(Move) || header.species_size != sizeof(SpeciesEntry) ||
+        strncmp(header.build, PROJECT_GIT_VERSION, sizeof(header.build) - 1) != 0)
+    {
+        sprintf(err_msg, "game master snapshot of another version or build, compile it again");
+        throw std::runtime_error(err_msg);
+    }
+    if (size != sizeof(header) + sizeof(GameMaster) + header.tables_size)
+    {
+        sprintf(err_msg, "truncated game master snapshot");
+        throw std::runtime_error(err_msg);
+    }
+
+    const char *tables = data + sizeof(header) + sizeof(GameMaster);
+    SnapshotReader reader(tables, tables + header.tables_size);
+    PokeTypeMapping new_poketype_mapping;
+    WeatherMapping new_weather_mapping;
+    Catalog new_catalog;
+    reader.read_names(header.num_type_names, new_poketype_mapping);
+    reader.read_names(header.num_weather_names, new_weather_mapping);
+    std::vector<double> cpms;
+    for (uint32_t i = 0; i < header.num_cp_multipliers; ++i)
+    {
+        cpms.push_back(reader.read_pod<double>());
+    }
+    new_catalog.set_cp_multipliers(cpms);
+    for (uint32_t i = 0; i < header.num_species; ++i)
+    {
+        auto name = reader.read_string();
+        new_catalog.add_species(name, reader.read_pod<SpeciesEntry>());
+    }
+    reader.read_moves(header.num_pve_moves, false, new_catalog);
+    reader.read_moves(header.num_pvp_moves, true, new_catalog);
+    if (!reader.at_end())
+    {
+        sprintf(err_msg, "corrupted game master snapshot");
+        throw std::runtime_error(err_msg);
+    }
+
+    memcpy(static_cast<void *>(&gm), data + sizeof(header), sizeof(GameMaster));
+    poketype_mapping = std::move(new_poketype_mapping);
+    weather_mapping = std::move(new_weather_mapping);
+    catalog = std::move(new_catalog);
+    fingerprint.assign(header.fingerprint, strnlen(header.fingerprint, sizeof(header.fingerprint)));
+}
+
+inline void load_snapshot(const std::string &path,
+                          GameMaster &gm,
+                          PokeTypeMapping &poketype_mapping,
+                          WeatherMapping &weather_mapping,
+                          Catalog &catalog,
+                          std::string &fingerprint)
+{
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        snprintf(err_msg, sizeof(err_msg), "bad file: %s", path.c_str());
+        throw std::runtime_error(err_msg);
+    }
+    size_t size = st.st_size;
+    void *data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        snprintf(err_msg, sizeof(err_msg), "cannot map %s", path.c_str());
+        throw std::runtime_error(err_msg);
+    }
+    try
+    {
+        read_snapshot(static_cast<const char *>(data), size, gm, poketype_mapping, weather_mapping, catalog, fingerprint);
+    }
+    catch (...)
+    {
+        munmap(data, size);
+        throw;
+    }
+    munmap(data, size);
+#else
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        snprintf(err_msg, sizeof(err_msg), "bad file: %s", path.c_str());
+        throw std::runtime_error(err_msg);
+    }
+    std::string data;
+    char buf[65536];
+    size_t num_read;
+    while ((num_read = fread(buf, 1, sizeof(buf), file)) > 0)
+    {
+        data.append(buf, num_read);
+    }
+    fclose(file);
+    read_snapshot(data.data(), data.size(), gm, poketype_mapping, weather_mapping, catalog, fingerprint);
+#endif
+}
+
+} // namespace GoBattleSim
@@ -6,9 +6,11 @@
 #include "GoBattleSim.h"
 #include "Application.h"
 #include "name_mapping.hpp"
+#include "catalog.hpp"
 
 #include "json.hpp"
 
+#include <algorithm>
 #include <string>
 #include <stdio.h>
 #include <vector>
@@ -96,6 +98,26 @@ void from_json(const json &j, Move &move)
     try_get_to(j, "effect", move.effect);
 }
 
+/**
+ * A move is either spelled out, or the name of a PvP (if @param pvp) or PvE move of the catalog.
+ */
+Move get_move(const json &j, bool pvp)
+{
+    if (!j.is_string())
+    {
+        return j.get<Move>();
+    }
+    auto name = j.get<std::string>();
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    auto move = Catalog::get().find_move(name, pvp);
+    if (move == nullptr)
+    {
+        sprintf(err_msg, "unknown %s move: %s", pvp ? "PvP" : "PvE", name.c_str());
+        throw std::runtime_error(err_msg);
+    }
+    return *move;
+}
+
 void to_json(json &j, const Pokemon &pkm)
 {
     const auto &typemap = PokeTypeMapping::get();
@@ -106,29 +128,88 @@ void to_json(json &j, const Pokemon &pkm)
     j["maxHP"] = pkm.max_hp;
     j["startingEnergy"] = pkm.starting_energy;
     j["immortal"] = pkm.immortal;
-    j["fmove"] = pkm.fmove;
-    j["cmoves"] = std::vector<Move>(pkm.cmoves, pkm.cmoves + pkm.cmoves_count);
+    j["fmove"] = *pkm.fmove;
+    j["cmoves"] = json::array();
+    for (unsigned i = 0; i < pkm.cmoves_count; ++i)
+    {
+        j["cmoves"].push_back(*pkm.cmoves[i]);
+    }
     if (pkm.strategy != nullptr)
     {
         j["strategy"] = pkm.strategy->name;
     }
 }
 
-void from_json(const json &j, Pokemon &pkm)
+/**
+ * Fill types and stats from catalog species j["species"] at j["level"] with j["ivs"] (default [15, 15, 15]).
+ * Fields given in @param j are left to the caller.
+ */
+void species_from_json(const json &j, Pokemon &pkm)
+{
+    const auto &catalog = Catalog::get();
+    auto name = j.at("species").get<std::string>();
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    auto idx = catalog.find_species(name);
+    if (idx < 0)
+    {
+        sprintf(err_msg, "unknown species: %s", name.c_str());
+        throw std::runtime_error(err_msg);
+    }
+    std::array<int, 3> ivs{15, 15, 15};
+    try_get_to(j, "ivs", ivs);
+    auto stats = catalog.stats(idx, j.at("level").get<double>(), ivs.data());
+
+    const auto &species = catalog.species(idx);
+    pkm.poketype1 = species.poketype1;
+    pkm.poketype2 = species.poketype2;
+    pkm.attack = stats.attack;
+    pkm.defense = stats.defense;
+    pkm.max_hp = stats.max_hp;
+}
+
+/**
+ * A Pokemon is either spelled out, or given by "species" and "level" of the catalog,
+ * with its moves by name. Fields spelled out override the ones from the catalog.
+ */
+void pokemon_from_json(const json &j, Pokemon &pkm, bool pvp)
 {
     const auto &typemap = PokeTypeMapping::get();
-    pkm.poketype1 = typemap.to_idx(j.at("pokeType1").get<std::string>());
-    pkm.poketype2 = typemap.to_idx(j.at("pokeType2").get<std::string>());
+    bool has_species = j.contains("species");
+    if (has_species)
+    {
+        species_from_json(j, pkm);
+    }
+    if (!has_species || j.contains("pokeType1"))
+    {
+        pkm.poketype1 = typemap.to_idx(j.at("pokeType1").get<std::string>());
+    }
+    if (!has_species || j.contains("pokeType2"))
+    {
+        pkm.poketype2 = typemap.to_idx(j.at("pokeType2").get<std::string>());
+    }
 
-    j.at("attack").get_to(pkm.attack);
-    j.at("defense").get_to(pkm.defense);
-    j.at("maxHP").get_to(pkm.max_hp);
-    j.at("startingEnergy").get_to(pkm.starting_energy);
+    if (!has_species || j.contains("attack"))
+    {
+        j.at("attack").get_to(pkm.attack);
+    }
+    if (!has_species || j.contains("defense"))
+    {
+        j.at("defense").get_to(pkm.defense);
+    }
+    if (!has_species || j.contains("maxHP"))
+    {
+        j.at("maxHP").get_to(pkm.max_hp);
+    }
+    if (!has_species || j.contains("startingEnergy"))
+    {
+        j.at("startingEnergy").get_to(pkm.starting_energy);
+    }
 
-    j.at("fmove").get_to(pkm.fmove);
+    auto fmove = get_move(j.at("fmove"), pvp);
+    pkm.add_fmove(&fmove);
     for (const auto &cmove_j : j.at("cmoves"))
     {
-        auto cmove = cmove_j.get<Move>();
+        auto cmove = get_move(cmove_j, pvp);
         pkm.add_cmove(&cmove);
     }
 
@@ -153,6 +234,11 @@ void from_json(const json &j, Pokemon &pkm)
     }
 }
 
+void from_json(const json &j, Pokemon &pkm)
+{
+    pokemon_from_json(j, pkm, false);
+}
+
 void to_json(json &j, const PvPPokemon &pkm)
 {
     to_json(j, static_cast<const Pokemon &>(pkm));
@@ -160,9 +246,9 @@ void to_json(json &j, const PvPPokemon &pkm)
 
 void from_json(const json &j, PvPPokemon &pkm)
 {
-    from_json(j, static_cast<Pokemon &>(pkm));
-    j.at("attack").get_to(pkm.attack_init);
-    j.at("defense").get_to(pkm.defense_init);
+    pokemon_from_json(j, pkm, true);
+    pkm.attack_init = pkm.attack;
+    pkm.defense_init = pkm.defense;
 }
 
 void to_json(json &j, const Party &party)
@@ -410,6 +496,37 @@ void from_json(const json &j, GameMaster &gm)
             gm.def_stage_multiplier(s, def_stage_multipliers.at(s - gm.min_stage));
         }
     }
+
+    // Species and moves, for inputs that refer to them by name
+    auto &catalog = Catalog::get();
+    catalog.reset();
+    std::vector<double> cpms;
+    try_get_to(j, "CPMultipliers", cpms);
+    catalog.set_cp_multipliers(cpms);
+    if (j.contains("Pokemon"))
+    {
+        for (const auto &pkm_j : j["Pokemon"])
+        {
+            SpeciesEntry entry;
+            entry.poketype1 = typemap.to_idx(pkm_j.at("pokeType1").get<std::string>());
+            entry.poketype2 = typemap.to_idx(pkm_j.at("pokeType2").get<std::string>());
+            pkm_j.at("baseAtk").get_to(entry.base_atk);
+            pkm_j.at("baseDef").get_to(entry.base_def);
+            pkm_j.at("baseStm").get_to(entry.base_stm);
+            catalog.add_species(pkm_j.at("name").get<std::string>(), entry);
+        }
+    }
+    for (auto pvp : {false, true})
+    {
+        auto moves_key = pvp ? "PvPMoves" : "PvEMoves";
+        if (j.contains(moves_key))
+        {
+            for (const auto &move_j : j[moves_key])
+            {
+                catalog.add_move(move_j.at("name").get<std::string>(), pvp, move_j.get<Move>());
+            }
+        }
+    }
 }
 
 void to_json(json &j, const ActionType &action_type)
@@ -545,6 +662,16 @@ void from_json(const json &j, AggregationMode &agg)
     }
 }
 
+void to_json(json &j, const MatrixFileFormat &format)
+{
+    j = matrix_file_format_name(format);
+}
+
+void from_json(const json &j, MatrixFileFormat &format)
+{
+    format = parse_matrix_file_format(j.get<std::string>());
+}
+
 void from_json(const json &j, PvESimInput &input)
 {
     const auto &weathermap = WeatherMapping::get();
@@ -560,6 +687,8 @@ void from_json(const json &j, PvESimInput &input)
     try_get_to(j, "numSims", 1u, input.num_sims);
     try_get_to(j, "enableLog", false, input.enable_log);
     try_get_to(j, "aggregation", AggregationMode::None, input.aggregation);
+    try_get_to(j, "seed", input.seed);
+    try_get_to(j, "traceFile", input.trace_file);
 }
 
 void to_json(json &j, const PokemonState &pkm_st)
@@ -627,6 +756,8 @@ void from_json(const json &j, PvPSimpleSimInput &input)
     try_get_to(j, "numSims", 1, input.num_sims);
     try_get_to(j, "aggregation", AggregationMode::Branching, input.aggregation);
     try_get_to(j, "enableLog", false, input.enable_log);
+    try_get_to(j, "seed", input.seed);
+    try_get_to(j, "traceFile", input.trace_file);
 }
 
 void to_json(json &j, const PvPPokemonState &pkm_st)
@@ -658,6 +789,44 @@ void to_json(json &j, const SimplePvPBattleOutcome &outcome)
     j["battleLog"] = outcome.battle_log;
 }
 
+void from_json(const json &j, TeamObjective &objective)
+{
+    auto objective_str = j.get<std::string>();
+    std::transform(objective_str.begin(), objective_str.end(), objective_str.begin(), ::tolower);
+    if (objective_str == "average")
+    {
+        objective = TeamObjective::Average;
+    }
+    else if (objective_str == "worst")
+    {
+        objective = TeamObjective::Worst;
+    }
+    else if (objective_str == "coverage")
+    {
+        objective = TeamObjective::Coverage;
+    }
+    else
+    {
+        sprintf(err_msg, "unknown team search objective: %s", objective_str.c_str());
+        throw std::runtime_error(err_msg);
+    }
+}
+
+void from_json(const json &j, TeamSearchOptions &options)
+{
+    try_get_to(j, "topK", options.top_k);
+    try_get_to(j, "threshold", options.threshold);
+    try_get_to(j, "objective", options.objective);
+}
+
+void to_json(json &j, const TeamScore &team)
+{
+    j["members"] = std::vector<unsigned>(team.members, team.members + TEAM_SIZE);
+    j["average"] = team.average;
+    j["worst"] = team.worst;
+    j["coverage"] = team.coverage;
+}
+
 void from_json(const json &j, BattleMatrixSimInput &input)
 {
     j["rowPokemon"].get_to(input.row_pokemon);
@@ -672,6 +841,71 @@ void from_json(const json &j, BattleMatrixSimInput &input)
     }
 
     try_get_to(j, "avergeByShield", false, input.averge_by_shield);
+
+    input.team_search = try_get_to(j, "teamSearch", input.team_search_options);
+    try_get_to(j, "seed", input.seed);
+    try_get_to(j, "traceFile", input.trace_file);
+
+    std::vector<unsigned> range;
+    if (try_get_to(j, "rowRange", range))
+    {
+        if (range.size() != 2)
+        {
+            sprintf(err_msg, "rowRange must be [first, last]");
+            throw std::runtime_error(err_msg);
+        }
+        input.row_first = range[0];
+        input.row_last = range[1];
+    }
+    if (try_get_to(j, "colRange", range))
+    {
+        if (range.size() != 2)
+        {
+            sprintf(err_msg, "colRange must be [first, last]");
+            throw std::runtime_error(err_msg);
+        }
+        input.col_first = range[0];
+        input.col_last = range[1];
+    }
+
+    try_get_to(j, "outputFile", input.output_file);
+    if (input.output_file.size() > 0)
+    {
+        try_get_to(j, "outputFormat", MatrixFileFormat::Float64, input.output_format);
+    }
+    else if (j.find("outputFormat") != j.end())
+    {
+        sprintf(err_msg, "outputFormat requires outputFile");
+        throw std::runtime_error(err_msg);
+    }
+}
+
+void to_json(json &j, const BattleMatrixFileOutput &output)
+{
+    j["outputFile"] = output.path;
+    j["outputFormat"] = output.format;
+    j["numRows"] = output.num_rows;
+    j["numCols"] = output.num_cols;
+}
+
+void to_json(json &j, const PerfCounters &perf)
+{
+    for (unsigned i = 0; i < NUM_EVENT_TYPES; ++i)
+    {
+        if (perf.events[i] > 0)
+        {
+            j["events"][json(static_cast<EventType>(i)).get<std::string>()] = perf.events[i];
+        }
+    }
+    j["heapPushes"] = perf.heap_pushes;
+    j["heapPops"] = perf.heap_pops;
+    j["peakQueueDepth"] = perf.peak_queue_depth;
+    const char *callback_names[NUM_STRATEGY_CALLBACKS] = {"onFree", "onClear", "onAttack"};
+    for (unsigned i = 0; i < NUM_STRATEGY_CALLBACKS; ++i)
+    {
+        j["strategyCalls"][callback_names[i]] = perf.strategy_calls[i];
+    }
+    j["branchNodes"] = perf.branch_nodes;
 }
 
 }; // namespace GoBattleSim
@@ -1,10 +1,16 @@
 
 #include "GoBattleSim_extern.h"
+#include "RequestServer.h"
+#include "ShardCoordinator.h"
+#include "SocketServer.h"
+#include "WorkloadGenerator.h"
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <streambuf>
 #include <string>
+#include <thread>
 
 #include "argparse.h"
 
@@ -14,9 +20,50 @@ std::string get_file_contents(std::ifstream &ifs)
                        std::istreambuf_iterator<char>());
 }
 
+/**
+ * Load a game master JSON or a snapshot compiled by --compile-gm.
+ */
+bool load_game_master(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.good())
+    {
+        std::cerr << "bad file: " << path << std::endl;
+        return false;
+    }
+    char magic[4] = {};
+    ifs.read(magic, sizeof(magic));
+    try
+    {
+        if (ifs.gcount() == sizeof(magic) && std::string(magic, sizeof(magic)) == "GBSG")
+        {
+            GBS_load_snapshot(path.c_str());
+        }
+        else
+        {
+            ifs.seekg(0);
+            GBS_config(get_file_contents(ifs).c_str());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
 void print_usage()
 {
     std::cout << "Usage: gbs {path/to/input.json} [, path/to/game_master.json]" << std::endl;
+    std::cout << "Usage: gbs {path/to/input.json} [, path/to/game_master.json] --workers N" << std::endl;
+    std::cout << "Usage: gbs {path/to/input.json} [, path/to/game_master.json] --hosts path/to/hosts.txt" << std::endl;
+    std::cout << "Usage: gbs {path/to/inputs.json or .jsonl} [, path/to/game_master.json] --batch" << std::endl;
+    std::cout << "Usage: gbs [path/to/game_master.json] --serve [num_threads]" << std::endl;
+    std::cout << "Usage: gbs [path/to/game_master.json] --listen {unix:/path/to/socket or [host:]port} [--threads N] [--queue N]" << std::endl;
+    std::cout << "Options: --cache N keeps the outputs of N seeded inputs in memory, --cache-dir DIR keeps them in DIR" << std::endl;
+    std::cout << "Usage: gbs --compile-gm {path/to/game_master.json} {path/to/game_master.bin}" << std::endl;
+    std::cout << "Usage: gbs {path/to/game_master.json} --gen-workload N [--seed S] [--mix raid:4,gym:2,pvp:3,matrix:1] [--sizes small:6,medium:3,large:1]" << std::endl;
     std::cout << "Usage: gbs --config" << std::endl;
     std::cout << "Usage: gbs --version" << std::endl;
 }
@@ -32,6 +79,20 @@ int main(int argc, const char **argv)
     parser.add_argument("c", "config", "print game master and exit", false);
     parser.add_argument("v", "version", "print version info and exit", false);
     parser.add_argument("o", "out", "save simulation output to file", false);
+    parser.add_argument("w", "workers", "run a battle matrix in N local worker processes", false);
+    parser.add_argument("s", "hosts", "run a battle matrix with one worker per command in the file", false);
+    parser.add_argument("b", "batch", "run a JSON array or JSON Lines of inputs", false);
+    parser.add_argument("S", "serve", "serve JSON Lines requests from stdin until it ends", false);
+    parser.add_argument("l", "listen", "serve JSON Lines requests on a Unix socket or local TCP port", false);
+    parser.add_argument("t", "threads", "number of simulation threads when listening", false);
+    parser.add_argument("q", "queue", "max number of requests waiting when listening (0 = no limit)", false);
+    parser.add_argument("G", "compile-gm", "compile a game master JSON into a binary snapshot that loads faster", false);
+    parser.add_argument("C", "cache", "keep the outputs of N seeded inputs in memory", false);
+    parser.add_argument("D", "cache-dir", "keep the outputs of seeded inputs in a directory", false);
+    parser.add_argument("g", "gen-workload", "print N simulation inputs sampled from the game master, as JSON Lines", false);
+    parser.add_argument("e", "seed", "seed of the generated workload", false);
+    parser.add_argument("m", "mix", "weights of the battle modes of the generated workload", false);
+    parser.add_argument("z", "sizes", "weights of the small, medium and large inputs of the generated workload", false);
     parser.parse(argc, argv);
 
     if (parser.exists("version") || parser.exists("v"))
@@ -43,23 +104,174 @@ int main(int argc, const char **argv)
     if (parser.exists("config") || parser.exists("c"))
     {
         auto cfg_fpath = parser.get<std::string>("config");
-        if (cfg_fpath.size() > 0)
+        if (cfg_fpath.size() > 0 && !load_game_master(cfg_fpath))
+        {
+            return -5;
+        }
+        std::cout << GBS_config(NULL) << std::endl;
+        return 0;
+    }
+
+    if (parser.exists("compile-gm") || parser.exists("G"))
+    {
+        auto paths = parser.exists("compile-gm") ? parser.getv<std::string>("compile-gm") : parser.getv<std::string>("G");
+        if (paths.size() != 2)
+        {
+            print_usage();
+            return -1;
+        }
+        std::ifstream gm_ifs(paths[0]);
+        if (!gm_ifs.good())
+        {
+            std::cerr << "bad file: " << paths[0] << std::endl;
+            return -3;
+        }
+        try
+        {
+            GBS_compile_snapshot(get_file_contents(gm_ifs).c_str(), paths[1].c_str());
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return -4;
+        }
+        return 0;
+    }
+
+    if (parser.exists("gen-workload") || parser.exists("g"))
+    {
+        auto gm_fpaths = parser.getv<std::string>("");
+        if (gm_fpaths.size() != 1)
+        {
+            print_usage();
+            return -1;
+        }
+        std::ifstream gm_ifs(gm_fpaths[0]);
+        if (!gm_ifs.good())
         {
-            std::ifstream ifs(cfg_fpath);
-            if (!ifs.good())
+            std::cerr << "bad file: " << gm_fpaths[0] << std::endl;
+            return -3;
+        }
+        std::vector<std::string> inputs;
+        try
+        {
+            GoBattleSim::WorkloadOptions options;
+            options.num_inputs = parser.exists("gen-workload") ? parser.get<unsigned>("gen-workload") : parser.get<unsigned>("g");
+            if (parser.exists("seed") || parser.exists("e"))
+            {
+                options.seed = parser.exists("seed") ? parser.get<unsigned>("seed") : parser.get<unsigned>("e");
+            }
+            if (parser.exists("mix") || parser.exists("m"))
+            {
+                auto mix = parser.exists("mix") ? parser.get<std::string>("mix") : parser.get<std::string>("m");
+                GoBattleSim::parse_workload_weights(mix, {"raid", "gym", "pvp", "matrix"}, options.mode_weights);
+            }
+            if (parser.exists("sizes") || parser.exists("z"))
             {
-                std::cerr << "bad file: " << cfg_fpath << std::endl;
-                return -5;
+                auto sizes = parser.exists("sizes") ? parser.get<std::string>("sizes") : parser.get<std::string>("z");
+                GoBattleSim::parse_workload_weights(sizes, {"small", "medium", "large"}, options.size_weights);
             }
-            auto content = get_file_contents(ifs);
-            GBS_config(content.c_str());
+            inputs = GoBattleSim::generate_workload(get_file_contents(gm_ifs), options);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return -4;
+        }
+
+        std::ofstream ofs;
+        if (parser.exists("out") || parser.exists("o"))
+        {
+            auto out_fpath = parser.exists("out") ? parser.get<std::string>("out") : parser.get<std::string>("o");
+            ofs.open(out_fpath);
+            if (!ofs.good())
+            {
+                std::cerr << "bad file: " << out_fpath << std::endl;
+                return -4;
+            }
+        }
+        std::ostream &os = ofs.is_open() ? ofs : std::cout;
+        for (const auto &input : inputs)
+        {
+            os << input << '\n';
         }
-        std::cout << GBS_config(NULL) << std::endl;
         return 0;
     }
 
+    bool cache = parser.exists("cache") || parser.exists("C");
+    bool cache_dir = parser.exists("cache-dir") || parser.exists("D");
+    if (cache || cache_dir)
+    {
+        unsigned max_entries = 0;
+        std::string dir;
+        if (cache)
+        {
+            max_entries = parser.exists("cache") ? parser.get<unsigned>("cache") : parser.get<unsigned>("C");
+        }
+        if (cache_dir)
+        {
+            dir = parser.exists("cache-dir") ? parser.get<std::string>("cache-dir") : parser.get<std::string>("D");
+        }
+        GBS_cache_config(max_entries, cache_dir ? dir.c_str() : NULL);
+    }
+
     auto positional_args = parser.getv<std::string>("");
 
+    bool serve = parser.exists("serve") || parser.exists("S");
+    bool listen = parser.exists("listen") || parser.exists("l");
+    if (serve || listen)
+    {
+        if (positional_args.size() >= 2)
+        {
+            print_usage();
+            return -1;
+        }
+        if (positional_args.size() == 1 && !load_game_master(positional_args[0]))
+        {
+            return -3;
+        }
+        if (serve)
+        {
+            // the number of threads is optional, so it is parsed from the string
+            auto num_threads_str = parser.exists("serve") ? parser.get<std::string>("serve") : parser.get<std::string>("S");
+            unsigned num_threads = std::thread::hardware_concurrency();
+            if (!num_threads_str.empty())
+            {
+                std::istringstream iss(num_threads_str);
+                if (num_threads_str.find_first_not_of("0123456789") != std::string::npos || !(iss >> num_threads))
+                {
+                    print_usage();
+                    return -1;
+                }
+            }
+            GoBattleSim::RequestServer server(num_threads);
+            server.serve(std::cin, std::cout);
+            return 0;
+        }
+        auto address = parser.exists("listen") ? parser.get<std::string>("listen") : parser.get<std::string>("l");
+        unsigned num_threads = std::thread::hardware_concurrency(), max_queue = 0;
+        if (parser.exists("threads") || parser.exists("t"))
+        {
+            num_threads = parser.exists("threads") ? parser.get<unsigned>("threads") : parser.get<unsigned>("t");
+        }
+        if (parser.exists("queue") || parser.exists("q"))
+        {
+            max_queue = parser.exists("queue") ? parser.get<unsigned>("queue") : parser.get<unsigned>("q");
+        }
+        try
+        {
+            GoBattleSim::RequestServer server(num_threads, max_queue);
+            GoBattleSim::SocketServer socket_server(server, address);
+            socket_server.run();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return -7;
+        }
+        return 0;
+    }
+
     if (positional_args.size() == 0 || positional_args.size() >= 3)
     {
         if (positional_args.size() == 0)
@@ -77,22 +289,54 @@ int main(int argc, const char **argv)
         return -2;
     }
 
-    if (positional_args.size() == 2)
+    if (positional_args.size() == 2 && !load_game_master(positional_args[1]))
     {
-        std::ifstream gm_ifs(positional_args[1]);
-        if (!gm_ifs.good())
+        return -3;
+    }
+
+    std::string output;
+    bool sharded = parser.exists("workers") || parser.exists("w") || parser.exists("hosts") || parser.exists("s");
+    if (sharded)
+    {
+        GoBattleSim::ShardOptions options;
+        options.gbs_path = argv[0];
+        options.game_master_path = positional_args.size() == 2 ? positional_args[1] : "";
+        try
         {
-            std::cerr << "bad file: " << positional_args[1] << std::endl;
-            return -3;
+            if (parser.exists("hosts") || parser.exists("s"))
+            {
+                auto hosts_fpath = parser.exists("hosts") ? parser.get<std::string>("hosts") : parser.get<std::string>("s");
+                options.worker_commands = GoBattleSim::read_worker_commands(hosts_fpath);
+            }
+            else
+            {
+                options.num_workers = parser.exists("workers") ? parser.get<unsigned>("workers") : parser.get<unsigned>("w");
+            }
+            output = GoBattleSim::run_sharded(get_file_contents(ifs), options);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return -6;
         }
-        GBS_config(get_file_contents(gm_ifs).c_str());
     }
+    else if (parser.exists("batch") || parser.exists("b"))
+    {
+        output = GBS_batch(get_file_contents(ifs).c_str());
+        // JSON Lines output already ends with a new line
+        if (!output.empty() && output.back() == '\n')
+        {
+            output.pop_back();
+        }
+    }
+    else
+    {
+        GBS_prepare(get_file_contents(ifs).c_str());
 
-    GBS_prepare(get_file_contents(ifs).c_str());
-
-    GBS_run();
+        GBS_run();
 
-    auto output = GBS_collect();
+        output = GBS_collect();
+    }
 
     if (parser.exists("out") || parser.exists("o"))
     {
@@ -63,6 +63,14 @@ public:
         }
     }
 
+    /**
+     * all names by index
+     */
+    const std::unordered_map<int, std::string> &names() const
+    {
+        return m_idx_to_name;
+    }
+
 private:
     std::unordered_map<int, std::string> m_idx_to_name;
     std::unordered_map<std::string, int> m_name_to_idx;
@@ -71,31 +79,53 @@ private:
 class PokeTypeMapping : public NameMapping
 {
 public:
+    /**
+     * the mapping bound to the calling thread, or the global one if none is bound.
+     */
     static PokeTypeMapping &get()
     {
-        return instance;
+        return bound != nullptr ? *bound : instance;
+    }
+
+    /**
+     * bind @param mapping to the calling thread (NULL for the global one), and return the previous one.
+     */
+    static PokeTypeMapping *bind(PokeTypeMapping *mapping)
+    {
+        auto prev = bound;
+        bound = mapping;
+        return prev;
     }
 
 private:
-    PokeTypeMapping() = default;
     static PokeTypeMapping instance;
+    static thread_local PokeTypeMapping *bound;
 };
 
 PokeTypeMapping PokeTypeMapping::instance;
+thread_local PokeTypeMapping *PokeTypeMapping::bound = nullptr;
 
 class WeatherMapping : public NameMapping
 {
 public:
     static WeatherMapping &get()
     {
-        return instance;
+        return bound != nullptr ? *bound : instance;
+    }
+
+    static WeatherMapping *bind(WeatherMapping *mapping)
+    {
+        auto prev = bound;
+        bound = mapping;
+        return prev;
     }
 
 private:
-    WeatherMapping() = default;
     static WeatherMapping instance;
+    static thread_local WeatherMapping *bound;
 };
 
 WeatherMapping WeatherMapping::instance;
+thread_local WeatherMapping *WeatherMapping::bound = nullptr;
 
 } // namespace GoBattleSim
@@ -0,0 +1,591 @@
+/**
+ * Micro and macro benchmarks of GoBattleSim, reported as a table on stderr and as JSON on stdout,
+ * so that throughput can be compared between commits.
+ *
+ * Usage: gbs_bench [--filter substring] [--min-time seconds] [--out path/to/report.json] [--root path/to/repo]
+ *                  [--baseline path/to/report.json [--tolerance fraction]] [--workload path/to/inputs.jsonl]
+ *
+ * With a baseline (a report of an earlier run), exit with 1 if a benchmark is slower than the baseline
+ * by more than the tolerance (0.4 by default). Baselines are scaled by the "calibration" benchmark,
+ * a fixed integer loop, so that they carry over to faster or slower machines of the same build type.
+ *
+ * The workload_ benchmarks run inputs made by `gbs GBS_GAME_MASTER.json --gen-workload N` (as JSON Lines),
+ * or 40 inputs generated the same way with seed 1 if no workload is given.
+ */
+
+#include "GoBattleSim.h"
+#include "GoBattleSim_extern.h"
+#include "WorkloadGenerator.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace GoBattleSim;
+using nlohmann::json;
+
+#ifndef GBS_BUILD_TYPE
+#define GBS_BUILD_TYPE ""
+#endif
+
+static std::atomic<uint64_t> num_allocs(0);
+
+void *operator new(size_t size)
+{
+    ++num_allocs;
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// once inlined, these free() memory that the compiler sees coming from operator new, which is what the pair does
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+struct BenchResult
+{
+    std::string name;
+    std::string unit;
+    uint64_t num_ops{0};
+    double seconds{0};
+    uint64_t num_allocs{0};
+};
+
+void to_json(json &j, const BenchResult &result)
+{
+    j["name"] = result.name;
+    j["unit"] = result.unit;
+    j["ops"] = result.num_ops;
+    j["seconds"] = result.seconds;
+    j["opsPerSec"] = result.num_ops / result.seconds;
+    j["nsPerOp"] = result.seconds * 1e9 / result.num_ops;
+    j["allocsPerOp"] = static_cast<double>(result.num_allocs) / result.num_ops;
+}
+
+class BenchRunner
+{
+public:
+    BenchRunner(const std::string &filter, double min_time) : m_filter(filter), m_min_time(min_time)
+    {
+    }
+
+    /**
+     * Call @param func, which does @param ops_per_call ops of @param unit, until at least the min time has passed.
+     */
+    template <class Func>
+    void run(const std::string &name, const std::string &unit, uint64_t ops_per_call, Func func)
+    {
+        // the calibration loop always runs, to scale baselines
+        if (name.find(m_filter) == std::string::npos && name != "calibration")
+        {
+            return;
+        }
+        BenchResult result;
+        result.name = name;
+        result.unit = unit;
+        auto allocs_before = num_allocs.load();
+        auto start = std::chrono::steady_clock::now();
+        do
+        {
+            func();
+            result.num_ops += ops_per_call;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (result.seconds < m_min_time);
+        result.num_allocs = num_allocs - allocs_before;
+
+        char line[256];
+        snprintf(line, sizeof(line), "%-36s %14.1f %s/s %12.1f ns/%s %10.2f allocs/%s",
+                 name.c_str(), result.num_ops / result.seconds, unit.c_str(),
+                 result.seconds * 1e9 / result.num_ops, unit.c_str(),
+                 static_cast<double>(result.num_allocs) / result.num_ops, unit.c_str());
+        std::cerr << line << std::endl;
+        m_results.push_back(result);
+    }
+
+    const std::vector<BenchResult> &results() const
+    {
+        return m_results;
+    }
+
+private:
+    std::string m_filter;
+    double m_min_time;
+    std::vector<BenchResult> m_results;
+};
+
+// keeps results alive, so that the compiler cannot drop the work
+static volatile double sink;
+
+class QueueBattle : public Battle
+{
+public:
+    using Battle::dequeue;
+    using Battle::enqueue;
+};
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    if (!ifs.good())
+    {
+        std::cerr << "bad file: " << path << std::endl;
+        exit(-2);
+    }
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+/**
+ * A fixed integer loop that does not touch the engine, as a measure of the machine's speed.
+ */
+void run_calibration(BenchRunner &runner)
+{
+    runner.run("calibration", "step", 100000, []() {
+        uint64_t x = 1;
+        for (int i = 0; i < 100000; ++i)
+        {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            x ^= x >> 29;
+        }
+        sink = x;
+    });
+}
+
+void run_micro(BenchRunner &runner, const std::string &root)
+{
+    // Mewtwo with Confusion against a Machamp raid boss, types as indexed in GBS.json
+    Pokemon mewtwo(14, -1, 248.94, 155.69, 180, 0), boss(5, -1, 286.94, 289.07, 15000, 0);
+    Move confusion(14, 20, 15, 1600, 600), psychic(14, 100, -100, 2800, 1300);
+    Move counter(5, 40, 15, 1100, 650), dynamic_punch(5, 90, -50, 2700, 1200);
+    mewtwo.add_fmove(&confusion);
+    mewtwo.add_cmove(&psychic);
+    boss.add_fmove(&counter);
+    boss.add_cmove(&dynamic_punch);
+
+    runner.run("calc_damage", "call", 1000, [&]() {
+        double total = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            total += calc_damage(&mewtwo, mewtwo.fmove, &boss, 1.0 + (i & 7) * 0.1);
+        }
+        sink = total;
+    });
+
+    QueueBattle battle;
+    runner.run("battle_enqueue_dequeue", "event", 256, [&]() {
+        unsigned time = 0;
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            battle.enqueue(TimelineEvent((i * 7919) % 1000 + time, EventType::Free, i % 4));
+            if (i % 4 == 3)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    time = battle.dequeue().time;
+                }
+            }
+        }
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            time = battle.dequeue().time;
+        }
+        sink = time;
+    });
+
+    PokemonState mewtwo_state, boss_state;
+    mewtwo_state.init();
+    boss_state.init();
+    StrategyInput input;
+    input.time_free = 1000;
+    input.subject = &mewtwo;
+    input.enemy = &boss;
+    input.subject_state = &mewtwo_state;
+    input.enemy_state = &boss_state;
+    input.enemy_action = Action(1500, ActionType::Charged, 0);
+    input.weather = -1;
+    input.game_master = &GameMaster::current();
+    runner.run("strategy_callbacks", "call", 1000 * NUM_PVE_STRATEGIES, [&]() {
+        Action action;
+        unsigned total = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            input.random_number = i;
+            mewtwo_state.energy = i % 100;
+            for (unsigned s = 0; s < NUM_PVE_STRATEGIES; ++s)
+            {
+                const auto &strategy = PVE_STRATEGIES[s];
+                auto responder = strategy.on_attack != nullptr ? strategy.on_attack : strategy.on_free;
+                responder(input, &action);
+                total += action.delay + static_cast<unsigned>(action.type);
+            }
+        }
+        sink = total;
+    });
+
+    // JSON goes through the C API, which owns the converters
+    auto ctx = GBS_create_context();
+    auto raid_j = read_file(root + "/examples/raid_solo.json");
+    runner.run("json_prepare_pve_input", "input", 1, [&]() {
+        GBS_prepare_ctx(ctx, raid_j.c_str());
+    });
+
+    GBS_run_ctx(ctx);
+    runner.run("json_collect_pve_output", "output", 1, [&]() {
+        sink = strlen(GBS_collect_ctx(ctx));
+    });
+
+    auto gm_j = read_file(root + "/GBS_GAME_MASTER.json");
+    runner.run("json_config_game_master", "input", 1, [&]() {
+        GBS_config_ctx(ctx, gm_j.c_str());
+    });
+    GBS_destroy_context(ctx);
+}
+
+/**
+ * The first @param size species of @param gm without forms, at level 40 with their first PvP moves.
+ */
+json matrix_input(const json &gm, unsigned size)
+{
+    std::set<std::string> pvp_moves;
+    for (const auto &move : gm["PvPMoves"])
+    {
+        pvp_moves.insert(move["name"].get<std::string>());
+    }
+    json pokemon = json::array();
+    for (const auto &species : gm["Pokemon"])
+    {
+        auto name = species["name"].get<std::string>();
+        if (name.find('-') != std::string::npos || species["fastMoves"].empty() || species["chargedMoves"].empty())
+        {
+            continue;
+        }
+        auto fmove = species["fastMoves"][0], cmove = species["chargedMoves"][0];
+        if (pvp_moves.count(fmove) == 0 || pvp_moves.count(cmove) == 0)
+        {
+            continue;
+        }
+        pokemon.push_back({{"species", name}, {"level", 40}, {"fmove", fmove}, {"cmoves", {cmove}}});
+        if (pokemon.size() == size)
+        {
+            break;
+        }
+    }
+    return {{"battleMode", "battlematrix"}, {"rowPokemon", pokemon}, {"colPokemon", pokemon}};
+}
+
+/**
+ * Time runs of @param input, prepared once if @param prepare_once (the run can be repeated), or before each run.
+ */
+void run_sims(BenchRunner &runner, GBS_Context *ctx, const std::string &name, const std::string &unit,
+              uint64_t ops_per_run, const json &input, bool prepare_once)
+{
+    auto input_j = input.dump();
+    if (prepare_once && GBS_prepare_ctx(ctx, input_j.c_str()) != 0)
+    {
+        std::cerr << name << ": " << GBS_error_ctx(ctx) << std::endl;
+        exit(-1);
+    }
+    runner.run(name, unit, ops_per_run, [&]() {
+        if (!prepare_once)
+        {
+            GBS_prepare_ctx(ctx, input_j.c_str());
+        }
+        GBS_run_ctx(ctx);
+    });
+}
+
+void run_macro(BenchRunner &runner, const std::string &root)
+{
+    auto ctx = GBS_create_context();
+
+    // averaged, so that repeated runs do not pile up outcomes
+    auto raid = json::parse(read_file(root + "/examples/raid_solo.json"));
+    raid["enableLog"] = false;
+    raid["numSims"] = 100;
+    raid["aggregation"] = "average";
+    run_sims(runner, ctx, "raid_solo", "sim", 100, raid, true);
+
+    for (unsigned i = 1; i < 20; ++i)
+    {
+        raid["players"].push_back(raid["players"][0]);
+    }
+    run_sims(runner, ctx, "raid_20_players", "sim", 100, raid, true);
+
+    // PvP outcomes are kept per sim, so the input is prepared again; enough sims make its parsing negligible
+    auto pvp = json::parse(read_file(root + "/examples/simple_pvp.json"));
+    pvp["enableLog"] = false;
+    pvp["numSims"] = 1000;
+    pvp["aggregation"] = "enum";
+    run_sims(runner, ctx, "pvp", "sim", 1000, pvp, false);
+    pvp["aggregation"] = "branching";
+    run_sims(runner, ctx, "pvp_branching", "sim", 1000, pvp, false);
+
+    // species are resolved by name from the game master
+    auto gm = json::parse(read_file(root + "/GBS_GAME_MASTER.json"));
+    for (unsigned size : {100, 500})
+    {
+        run_sims(runner, ctx, "matrix_" + std::to_string(size), "cell", static_cast<uint64_t>(size) * size,
+                 matrix_input(gm, size), true);
+    }
+
+    GBS_destroy_context(ctx);
+}
+
+/**
+ * Every input of examples/, seeded and without logs, prepared and run as a whole.
+ */
+void run_examples(BenchRunner &runner, const std::string &root)
+{
+    std::vector<std::string> names;
+    DIR *dir = opendir((root + "/examples").c_str());
+    for (dirent *entry = dir != nullptr ? readdir(dir) : nullptr; entry != nullptr; entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0)
+        {
+            names.push_back(name.substr(0, name.size() - 5));
+        }
+    }
+    if (dir != nullptr)
+    {
+        closedir(dir);
+    }
+    std::sort(names.begin(), names.end());
+
+    // the examples are written for the default game master, like the app_ tests
+    auto ctx = GBS_create_context();
+    GBS_config_ctx(ctx, read_file(root + "/setting/GBS.json").c_str());
+    for (const auto &name : names)
+    {
+        auto input = json::parse(read_file(root + "/examples/" + name + ".json"));
+        input["seed"] = 1;
+        input["enableLog"] = false;
+        uint64_t ops_per_run = 0;
+        std::string unit = "sim";
+        if (input["battleMode"] == "battlematrix")
+        {
+            auto num_rows = input["rowPokemon"].size(), num_cols = input.value("colPokemon", json::array()).size();
+            ops_per_run = num_rows * (num_cols > 0 ? num_cols : num_rows);
+            unit = "cell";
+        }
+        else
+        {
+            input["numSims"] = 200;
+            ops_per_run = 200;
+        }
+        run_sims(runner, ctx, "example_" + name, unit, ops_per_run, input, false);
+    }
+    GBS_destroy_context(ctx);
+}
+
+/**
+ * Every input of the workload at @param path (or generated, if empty), grouped by battle mode.
+ * A group is prepared and run as a whole, input by input.
+ */
+void run_workload(BenchRunner &runner, const std::string &root, const std::string &path)
+{
+    std::vector<std::string> inputs;
+    if (path.empty())
+    {
+        WorkloadOptions options;
+        options.num_inputs = 40;
+        options.seed = 1;
+        inputs = generate_workload(read_file(root + "/GBS_GAME_MASTER.json"), options);
+    }
+    else
+    {
+        std::ifstream ifs(path);
+        for (std::string line; std::getline(ifs, line);)
+        {
+            if (line.find_first_not_of(" \t\r") != std::string::npos)
+            {
+                inputs.push_back(line);
+            }
+        }
+    }
+
+    std::map<std::string, std::vector<std::string>> groups;
+    for (const auto &input : inputs)
+    {
+        groups[json::parse(input)["battleMode"].get<std::string>()].push_back(input);
+    }
+
+    // the global context has the full game master the workload is sampled from
+    auto ctx = GBS_create_context();
+    for (const auto &group : groups)
+    {
+        runner.run("workload_" + group.first, "input", group.second.size(), [&]() {
+            for (const auto &input : group.second)
+            {
+                if (GBS_prepare_ctx(ctx, input.c_str()) != 0 || GBS_run_ctx(ctx) != 0)
+                {
+                    std::cerr << "workload_" << group.first << ": " << GBS_error_ctx(ctx) << std::endl;
+                    exit(-1);
+                }
+            }
+        });
+    }
+    GBS_destroy_context(ctx);
+}
+
+/**
+ * Compare @param results to the @param baseline report, and @return whether none is slower by more than @param tolerance.
+ * A baseline of another build type fails the check, as nothing in it would be comparable.
+ */
+bool check_baseline(const std::vector<BenchResult> &results, const json &baseline, double tolerance)
+{
+    std::string build_type = GBS_BUILD_TYPE[0] != '\0' ? GBS_BUILD_TYPE : "none";
+    if (baseline["buildType"] != build_type)
+    {
+        std::cerr << "baseline is of build type " << baseline["buildType"] << ", not comparable to " << build_type << std::endl;
+        return false;
+    }
+    // battle matrices run on every core, so their throughput only compares on as many threads
+    unsigned threads = std::thread::hardware_concurrency();
+    bool same_threads = baseline.value("threads", 0u) == threads;
+    std::map<std::string, double> base_ops;
+    for (const auto &bench : baseline["benchmarks"])
+    {
+        base_ops[bench["name"]] = bench["opsPerSec"];
+    }
+    double speed = 1;
+    for (const auto &result : results)
+    {
+        if (result.name == "calibration" && base_ops.count("calibration") > 0)
+        {
+            speed = result.num_ops / result.seconds / base_ops["calibration"];
+        }
+    }
+
+    bool ok = true;
+    for (const auto &result : results)
+    {
+        if (result.name == "calibration" || base_ops.count(result.name) == 0)
+        {
+            continue;
+        }
+        if (result.unit == "cell" && !same_threads)
+        {
+            std::cerr << result.name << " skipped, baseline ran on " << baseline["threads"] << " threads, not " << threads
+                      << std::endl;
+            continue;
+        }
+        double expected = base_ops[result.name] * speed, actual = result.num_ops / result.seconds;
+        bool passed = actual >= expected * (1 - tolerance);
+        char line[256];
+        snprintf(line, sizeof(line), "%-36s %6.2fx of baseline%s", result.name.c_str(), actual / expected,
+                 passed ? "" : "  REGRESSION");
+        std::cerr << line << std::endl;
+        ok = ok && passed;
+    }
+    return ok;
+}
+
+int main(int argc, const char **argv)
+{
+    std::string root(__FILE__), filter, out_path, baseline_path, workload_path;
+    root = root.substr(0, root.rfind("/test/benchmark/"));
+    double min_time = 0.5, tolerance = 0.4;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--filter")
+        {
+            filter = argv[i + 1];
+        }
+        else if (arg == "--min-time")
+        {
+            min_time = atof(argv[i + 1]);
+        }
+        else if (arg == "--out")
+        {
+            out_path = argv[i + 1];
+        }
+        else if (arg == "--root")
+        {
+            root = argv[i + 1];
+        }
+        else if (arg == "--baseline")
+        {
+            baseline_path = argv[i + 1];
+        }
+        else if (arg == "--tolerance")
+        {
+            tolerance = atof(argv[i + 1]);
+        }
+        else if (arg == "--workload")
+        {
+            workload_path = argv[i + 1];
+        }
+        else
+        {
+            std::cerr << "unknown option: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    // the full game master, for the matrices of species by name
+    GBS_config(read_file(root + "/GBS_GAME_MASTER.json").c_str());
+
+    BenchRunner runner(filter, min_time);
+    run_calibration(runner);
+    run_micro(runner, root);
+    run_macro(runner, root);
+    run_examples(runner, root);
+    run_workload(runner, root, workload_path);
+
+    json report;
+    report["version"] = GBS_version();
+    // CMAKE_BUILD_TYPE, empty for the unoptimized default
+    report["buildType"] = GBS_BUILD_TYPE[0] != '\0' ? GBS_BUILD_TYPE : "none";
+    report["threads"] = std::thread::hardware_concurrency();
+    report["minTime"] = min_time;
+    report["benchmarks"] = runner.results();
+    if (out_path.empty())
+    {
+        std::cout << report.dump(4) << std::endl;
+    }
+    else
+    {
+        std::ofstream(out_path) << report.dump(4) << std::endl;
+    }
+
+    if (!baseline_path.empty() && !check_baseline(runner.results(), json::parse(read_file(baseline_path)), tolerance))
+    {
+        return 1;
+    }
+
+    return 0;
+}
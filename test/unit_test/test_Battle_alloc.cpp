@@ -0,0 +1,157 @@
+#include "Battle.h"
+#include "GameMaster.h"
+#include "Random.h"
+#include "SimplePvPBattle.h"
+
+#include <assert.h>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// every heap allocation of the process, including the library's
+static std::atomic<unsigned long> num_allocs{0};
+
+void *operator new(std::size_t size)
+{
+    ++num_allocs;
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using namespace GoBattleSim;
+
+/**
+ * Number of heap allocations made by @param num_sims calls of init() and start() of @param battle,
+ * after as many calls to warm it up.
+ */
+template <typename BattleType>
+unsigned long count_allocs(BattleType &battle, unsigned num_sims)
+{
+    for (unsigned i = 0; i < num_sims; ++i)
+    {
+        battle.init();
+        battle.start();
+    }
+    auto before = num_allocs.load();
+    for (unsigned i = 0; i < num_sims; ++i)
+    {
+        battle.init();
+        battle.start();
+    }
+    return num_allocs.load() - before;
+}
+
+int main()
+{
+    // 0 = Psychic, 1 = Fighting, 2 = Steel, 3 = Flying
+    GameMaster::get().num_types(4);
+    GameMaster::get().effectiveness(0, 1, 1.6);
+    GameMaster::get().effectiveness(1, 0, 1 / 1.6);
+    GameMaster::get().effectiveness(1, 2, 1.6);
+    GameMaster::get().effectiveness(3, 1, 1.6);
+    GameMaster::get().set_stage_bounds(-4, 4);
+    for (int i = -4; i <= 4; ++i)
+    {
+        GameMaster::get().atk_stage_multiplier(i, i < 0 ? 4.0 / (4 - i) : (4.0 + i) / 4);
+        GameMaster::get().def_stage_multiplier(i, i < 0 ? 4.0 / (4 - i) : (4.0 + i) / 4);
+    }
+    seed_random(1000);
+
+    Move move_confusion{0, 20, 15, 1600, 600};
+    Move move_psychic{0, 100, -100, 2800, 1300};
+    Move move_counter{1, 12, 8, 900, 700};
+    Move move_dynamic_punch{1, 90, -50, 2700, 1200};
+
+    Pokemon mewtwo(0, -1, 248.9, 155.7, 180, 0);
+    mewtwo.add_fmove(&move_confusion);
+    mewtwo.add_cmove(&move_psychic);
+    Pokemon machamp(1, -1, 181.8, 127.0, 15000, 0);
+    machamp.add_fmove(&move_counter);
+    machamp.add_cmove(&move_dynamic_punch);
+
+    std::cout << "testing raid battle allocations ... ";
+    {
+        Party attacker_party;
+        for (int i = 0; i < 6; ++i)
+        {
+            attacker_party.add(&mewtwo);
+        }
+        attacker_party.revive_policy = true;
+        Party boss_party;
+        boss_party.add(&machamp);
+
+        Player boss;
+        boss.team = 0;
+        boss.add(&boss_party);
+        boss.set_strategy(STRATEGY_DEFENDER);
+
+        Battle battle;
+        battle.set_time_limit(180000);
+        battle.set_background_dps(20);
+        battle.add_player(&boss);
+        for (int i = 0; i < 20; ++i)
+        {
+            Player attacker;
+            attacker.team = 1;
+            attacker.add(&attacker_party);
+            attacker.set_strategy(i % 2 ? STRATEGY_ATTACKER_DODGE_ALL : STRATEGY_ATTACKER_NO_DODGE);
+            battle.add_player(&attacker);
+        }
+        assert(count_allocs(battle, 20) == 0);
+
+        // the outcome reuses the vectors it was given
+        PvEBattleOutcome outcome;
+        battle.get_outcome(1, outcome);
+        auto before = num_allocs.load();
+        battle.init();
+        battle.start();
+        battle.get_outcome(1, outcome);
+        assert(num_allocs.load() == before);
+        (void)before;
+        assert(outcome.pokemon_stats.size() == 121);
+        assert(outcome.battle_log.empty());
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing PvP battle allocations ... ";
+    {
+        Move move_counter_pvp{1, 8, 7, 2};
+        Move move_power_up_punch{1, 40, -35, 0, 0, {1, 1}};
+        Move move_ancient_power{0, 70, -45, 0, 0, {0.1, 2, 2}};
+
+        PvPPokemon lucario(1, 2, 190.4, 121.1, 142, 0);
+        lucario.add_fmove(&move_counter_pvp);
+        lucario.add_cmove(&move_power_up_punch);
+        lucario.add_cmove(&move_ancient_power);
+        lucario.num_shields_max = 2;
+
+        SimplePvPBattle battle;
+        battle.set_pokemon(lucario, lucario);
+        assert(count_allocs(battle, 20) == 0);
+
+        // a mirror match branches on charged move priority and on move effects
+        battle.set_enable_branching(true);
+        auto expected = (battle.init(), battle.start(), battle.get_outcome());
+        assert(count_allocs(battle, 20) == 0);
+        auto outcome = battle.get_outcome();
+        assert(outcome.tdo_percent[0] == expected.tdo_percent[0]);
+        assert(outcome.tdo_percent[1] == expected.tdo_percent[1]);
+    }
+    std::cout << "success" << std::endl;
+
+    return 0;
+}
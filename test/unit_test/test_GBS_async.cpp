@@ -0,0 +1,141 @@
+#include "GoBattleSim_extern.h"
+
+#include <assert.h>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+struct Job
+{
+    std::string output;
+    int status{-1};
+    std::atomic<int> *num_done;
+};
+
+void on_done(GBS_Context *ctx, int status, void *user_data)
+{
+    auto job = static_cast<Job *>(user_data);
+    job->status = status;
+    job->output = GBS_collect_ctx(ctx);
+    // the job is not over until the callback returns
+    int done = GBS_poll(ctx);
+    assert(done == 0);
+    int rerun = GBS_run_async(ctx, nullptr, nullptr);
+    assert(rerun != 0);
+    int waited = GBS_wait(ctx);
+    assert(waited == status);
+    ++*job->num_done;
+    (void)done;
+    (void)rerun;
+    (void)waited;
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    GBS_config(read_file(root + "/setting/GBS.json").c_str());
+    std::vector<std::string> inputs = {
+        read_file(root + "/examples/simple_pvp.json"),
+        read_file(root + "/examples/battle_matrix_kanto_starters.json"),
+    };
+
+    std::vector<std::string> expected;
+    for (const auto &input : inputs)
+    {
+        GBS_prepare(input.c_str());
+        GBS_run();
+        expected.push_back(GBS_collect());
+    }
+
+    std::cout << "testing async runs with callbacks ... ";
+    {
+        const unsigned num_jobs = 8;
+        std::atomic<int> num_done(0);
+        std::vector<GBS_Context *> contexts(num_jobs);
+        std::vector<Job> jobs(num_jobs);
+        for (unsigned i = 0; i < num_jobs; ++i)
+        {
+            contexts[i] = GBS_create_context();
+            jobs[i].num_done = &num_done;
+            int status = GBS_prepare_ctx(contexts[i], inputs[i % inputs.size()].c_str());
+            assert(status == 0);
+            status = GBS_run_async(contexts[i], on_done, &jobs[i]);
+            assert(status == 0);
+            (void)status;
+        }
+        for (unsigned i = 0; i < num_jobs; ++i)
+        {
+            int status = GBS_wait(contexts[i]);
+            assert(status == 0);
+            int done = GBS_poll(contexts[i]);
+            assert(done == 1);
+            (void)status;
+            (void)done;
+        }
+        assert(num_done == static_cast<int>(num_jobs));
+        for (unsigned i = 0; i < num_jobs; ++i)
+        {
+            GBS_destroy_context(contexts[i]);
+        }
+        for (unsigned i = 0; i < num_jobs; ++i)
+        {
+            assert(jobs[i].status == 0);
+            assert(jobs[i].output == expected[i % inputs.size()]);
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing async run with polling ... ";
+    {
+        auto ctx = GBS_create_context();
+        int done = GBS_poll(ctx);
+        assert(done == 1);
+        int status = GBS_prepare_ctx(ctx, inputs[1].c_str());
+        assert(status == 0);
+        status = GBS_run_async(ctx, nullptr, nullptr);
+        assert(status == 0);
+        while (GBS_poll(ctx) == 0)
+        {
+        }
+        status = GBS_wait(ctx);
+        assert(status == 0);
+        std::string output = GBS_collect_ctx(ctx);
+        assert(output == expected[1]);
+        GBS_destroy_context(ctx);
+        (void)done;
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing context destroyed as soon as polled done ... ";
+    {
+        // the job must not touch the context once GBS_poll() reports it done
+        for (int k = 0; k < 200; ++k)
+        {
+            auto ctx = GBS_create_context();
+            int status = GBS_prepare_ctx(ctx, inputs[0].c_str());
+            assert(status == 0);
+            status = GBS_run_async(ctx, nullptr, nullptr);
+            assert(status == 0);
+            while (GBS_poll(ctx) == 0)
+            {
+            }
+            GBS_destroy_context(ctx);
+            (void)status;
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "GoBattleSim_extern.h"
+#include "json.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <stdlib.h>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+std::string simulate(const std::string &input_j)
+{
+    GBS_prepare(input_j.c_str());
+    GBS_run();
+    return GBS_collect();
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    GBS_config(read_file(root + "/setting/GBS.json").c_str());
+
+    auto raid = nlohmann::json::parse(read_file(root + "/examples/raid_solo.json"));
+    raid["enableLog"] = false;
+    raid["numSims"] = 20;
+    raid["aggregation"] = "average";
+    raid["seed"] = 7;
+    auto matrix = nlohmann::json::parse(read_file(root + "/examples/battle_matrix_kanto_starters.json"));
+    matrix["seed"] = 7;
+
+    std::cout << "testing seeded runs ... ";
+    auto raid_output = simulate(raid.dump());
+    std::string output = simulate(raid.dump());
+    assert(output == raid_output);
+    auto matrix_output = simulate(matrix.dump());
+    output = simulate(matrix.dump());
+    assert(output == matrix_output);
+    std::cout << "success" << std::endl;
+
+    char dir_template[] = "/tmp/gbs_cache_XXXXXX";
+    std::string dir = mkdtemp(dir_template);
+    unsigned long long num_hits = 0, num_misses = 0;
+
+    std::cout << "testing memory cache ... ";
+    {
+        GBS_cache_config(16, dir.c_str());
+        output = simulate(raid.dump());
+        assert(output == raid_output);
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 0 && num_misses == 1);
+
+        // same input with the keys in another order
+        auto reordered = "{\"seed\": 7, " + raid.dump().substr(1);
+        output = simulate(reordered);
+        assert(output == raid_output);
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 1 && num_misses == 1);
+
+        // unseeded inputs are not looked up
+        auto unseeded = raid;
+        unseeded.erase("seed");
+        simulate(unseeded.dump());
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 1 && num_misses == 1);
+
+        // a context has the same game master, so it shares the output
+        auto ctx = GBS_create_context();
+        for (int k = 0; k < 2; ++k)
+        {
+            int status = GBS_prepare_ctx(ctx, matrix.dump().c_str());
+            assert(status == 0);
+            status = GBS_run_ctx(ctx);
+            assert(status == 0);
+            output = GBS_collect_ctx(ctx);
+            assert(output == matrix_output);
+            (void)status;
+        }
+        GBS_destroy_context(ctx);
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 2 && num_misses == 2);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing disk cache ... ";
+    {
+        GBS_cache_config(0, dir.c_str());
+        output = simulate(raid.dump());
+        assert(output == raid_output);
+        output = simulate(matrix.dump());
+        assert(output == matrix_output);
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 4 && num_misses == 2);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing unreadable disk entries ... ";
+    {
+        int status = system(("for f in " + dir + "/*; do printf garbage > $f; done").c_str());
+        assert(status == 0);
+        output = simulate(raid.dump());
+        assert(output == raid_output);
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 4 && num_misses == 3);
+        // the entry is written again
+        output = simulate(raid.dump());
+        assert(output == raid_output);
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 5 && num_misses == 3);
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing game master change ... ";
+    {
+        GBS_cache_config(16, NULL);
+        auto gm = nlohmann::json::parse(read_file(root + "/setting/GBS.json"));
+        gm["PvEBattleSettings"]["fastMoveLagMs"] = 0;
+        GBS_config(gm.dump().c_str());
+        simulate(raid.dump());
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 5 && num_misses == 4);
+    }
+    std::cout << "success" << std::endl;
+
+    GBS_cache_config(0, NULL);
+    system(("rm -rf " + dir).c_str());
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "GoBattleSim_extern.h"
+#include "json.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+nlohmann::json find_by_name(const nlohmann::json &list, const std::string &name)
+{
+    for (const auto &item : list)
+    {
+        if (item["name"] == name)
+        {
+            return item;
+        }
+    }
+    assert(false);
+    return nullptr;
+}
+
+/**
+ * Spell out a Pokemon at level 40 with 15/15/15 IVs, like the catalog should.
+ */
+nlohmann::json spell_out(const nlohmann::json &gm, const std::string &species, const std::string &fmove,
+                         const std::string &cmove, bool pvp)
+{
+    auto entry = find_by_name(gm["Pokemon"], species);
+    double cpm = gm["CPMultipliers"][78];
+    const auto &moves = gm[pvp ? "PvPMoves" : "PvEMoves"];
+    return {
+        {"pokeType1", entry["pokeType1"]},
+        {"pokeType2", entry["pokeType2"]},
+        {"attack", (entry["baseAtk"].get<int>() + 15) * cpm},
+        {"defense", (entry["baseDef"].get<int>() + 15) * cpm},
+        {"maxHP", std::max(10, static_cast<int>((entry["baseStm"].get<int>() + 15) * cpm))},
+        {"startingEnergy", 0},
+        {"fmove", find_by_name(moves, fmove)},
+        {"cmoves", {find_by_name(moves, cmove)}},
+    };
+}
+
+std::string simulate(GBS_Context *ctx, const nlohmann::json &input)
+{
+    int status = GBS_prepare_ctx(ctx, input.dump().c_str());
+    assert(status == 0);
+    status = GBS_run_ctx(ctx);
+    assert(status == 0);
+    (void)status;
+    return GBS_collect_ctx(ctx);
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    auto gm_j = read_file(root + "/GBS_GAME_MASTER.json");
+    auto gm = nlohmann::json::parse(gm_j);
+    GBS_config(gm_j.c_str());
+    auto ctx = GBS_create_context();
+
+    std::cout << "testing PvE species by name ... ";
+    {
+        nlohmann::json boss = spell_out(gm, "machamp", "counter", "dynamic punch", false);
+        boss["maxHP"] = 3600;
+        boss["immortal"] = true;
+        boss["strategy"] = "DEFENDER";
+        nlohmann::json attacker = {
+            {"species", "Mewtwo"},
+            {"level", 40},
+            {"ivs", {15, 15, 15}},
+            {"fmove", "confusion"},
+            {"cmoves", {"psychic"}},
+            {"strategy", "ATTACKER_NO_DODGE"},
+        };
+        nlohmann::json input = {
+            {"battleMode", "raid"},
+            {"timelimit", 180000},
+            {"seed", 3},
+            {"players", {
+                {{"team", 1}, {"parties", {{{"pokemon", {attacker}}}}}},
+                {{"team", 0}, {"parties", {{{"pokemon", {boss}}}}}},
+            }},
+        };
+        auto by_name = simulate(ctx, input);
+
+        auto spelled_out = spell_out(gm, "mewtwo", "confusion", "psychic", false);
+        spelled_out["strategy"] = "ATTACKER_NO_DODGE";
+        input["players"][0]["parties"][0]["pokemon"][0] = spelled_out;
+        auto output = simulate(ctx, input);
+        assert(output == by_name);
+
+        // spelled out fields override the catalog
+        attacker["maxHP"] = 1;
+        input["players"][0]["parties"][0]["pokemon"][0] = attacker;
+        output = simulate(ctx, input);
+        assert(output != by_name);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing PvP moves by name ... ";
+    {
+        nlohmann::json input = {
+            {"battleMode", "battlematrix"},
+            {"rowPokemon", {{{"species", "latios"}, {"level", 40}, {"fmove", "dragon breath"}, {"cmoves", {"dragon claw"}}}}},
+            {"colPokemon", {{{"species", "machamp"}, {"level", 40}, {"fmove", "counter"}, {"cmoves", {"dynamic punch"}}}}},
+        };
+        auto by_name = simulate(ctx, input);
+        input["rowPokemon"][0] = spell_out(gm, "latios", "dragon breath", "dragon claw", true);
+        input["colPokemon"][0] = spell_out(gm, "machamp", "counter", "dynamic punch", true);
+        auto output = simulate(ctx, input);
+        assert(output == by_name);
+
+        // HP is at least 10, even with a base stamina of 1 and no IV
+        input["rowPokemon"][0] = {{"species", "shedinja"}, {"level", 40}, {"ivs", {15, 15, 0}}, {"fmove", "counter"}, {"cmoves", {"dynamic punch"}}};
+        by_name = simulate(ctx, input);
+        input["rowPokemon"][0] = spell_out(gm, "shedinja", "counter", "dynamic punch", true);
+        input["rowPokemon"][0]["maxHP"] = 10;
+        output = simulate(ctx, input);
+        assert(output == by_name);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing bad names ... ";
+    {
+        nlohmann::json input = {
+            {"battleMode", "battlematrix"},
+            {"rowPokemon", {{{"species", "missingno"}, {"level", 40}, {"fmove", "counter"}, {"cmoves", {"dynamic punch"}}}}},
+        };
+        int status = GBS_prepare_ctx(ctx, input.dump().c_str());
+        assert(status != 0);
+        assert(std::string(GBS_error_ctx(ctx)) == "unknown species: missingno");
+
+        input["rowPokemon"][0]["species"] = "machamp";
+        input["rowPokemon"][0]["fmove"] = "splash dance";
+        status = GBS_prepare_ctx(ctx, input.dump().c_str());
+        assert(status != 0);
+        assert(std::string(GBS_error_ctx(ctx)) == "unknown PvP move: splash dance");
+
+        input["rowPokemon"][0]["fmove"] = "counter";
+        input["rowPokemon"][0]["level"] = 40.3;
+        status = GBS_prepare_ctx(ctx, input.dump().c_str());
+        assert(status != 0);
+        input["rowPokemon"][0]["level"] = 40;
+        input["rowPokemon"][0]["ivs"] = {16, 0, 0};
+        status = GBS_prepare_ctx(ctx, input.dump().c_str());
+        assert(status != 0);
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing catalog in snapshot ... ";
+    {
+        nlohmann::json input = {
+            {"battleMode", "battlematrix"},
+            {"rowPokemon", {{{"species", "latios"}, {"level", 40}, {"fmove", "dragon breath"}, {"cmoves", {"dragon claw"}}}}},
+            {"colPokemon", {{{"species", "machamp"}, {"level", 40}, {"fmove", "counter"}, {"cmoves", {"dynamic punch"}}}}},
+        };
+        auto expected = simulate(ctx, input);
+        std::string path = "/tmp/gbs_catalog_" + std::to_string(getpid()) + ".bin";
+        GBS_compile_snapshot(gm_j.c_str(), path.c_str());
+        auto snapshot_ctx = GBS_create_context();
+        int status = GBS_load_snapshot_ctx(snapshot_ctx, path.c_str());
+        assert(status == 0);
+        auto output = simulate(snapshot_ctx, input);
+        assert(output == expected);
+        (void)status;
+        GBS_destroy_context(snapshot_ctx);
+        remove(path.c_str());
+    }
+    std::cout << "success" << std::endl;
+
+    GBS_destroy_context(ctx);
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+
+#include "GoBattleSim_extern.h"
+#include "Move.h"
+#include "json.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    auto gm_j = read_file(root + "/setting/GBS.json");
+    auto input_j = read_file(root + "/examples/simple_pvp.json");
+
+    std::cout << "testing context without game master ... ";
+    {
+        auto ctx = GBS_create_context();
+        int status = GBS_prepare_ctx(ctx, "{\"battleMode\": \"nonsense\"}");
+        assert(status != 0);
+        assert(std::string(GBS_error_ctx(ctx)).size() > 0);
+        GBS_destroy_context(ctx);
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing context against legacy API ... ";
+    GBS_config(gm_j.c_str());
+    GBS_prepare(input_j.c_str());
+    GBS_run();
+    std::string expected = GBS_collect();
+    {
+        auto ctx = GBS_create_context();
+        int status = GBS_prepare_ctx(ctx, input_j.c_str());
+        assert(status == 0);
+        status = GBS_run_ctx(ctx);
+        assert(status == 0);
+        std::string output = GBS_collect_ctx(ctx);
+        assert(output == expected);
+        GBS_destroy_context(ctx);
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing context-owned buffers ... ";
+    {
+        auto ctx = GBS_create_context();
+        int status = GBS_prepare_ctx(ctx, input_j.c_str());
+        assert(status == 0);
+        status = GBS_run_ctx(ctx);
+        assert(status == 0);
+        size_t size1 = 0, size2 = 0;
+        auto buffer1 = static_cast<const char *>(GBS_collect_buffer_ctx(ctx, GBS_ENCODING_JSON, &size1));
+        auto buffer2 = static_cast<const char *>(GBS_collect_buffer_ctx(ctx, GBS_ENCODING_JSON_COMPACT, &size2));
+        // the first buffer is still valid after the second collect
+        assert(buffer1 != buffer2);
+        assert(std::string(buffer1, size1) == expected);
+        assert(size2 < size1);
+        status = GBS_free_buffer_ctx(ctx, buffer1);
+        assert(status == 0);
+        status = GBS_free_buffer_ctx(ctx, buffer1);
+        assert(status != 0);
+        auto buffer3 = GBS_collect_buffer_ctx(ctx, 42, &size1);
+        assert(buffer3 == nullptr && size1 == 0);
+        // buffer2 is released with the context
+        GBS_destroy_context(ctx);
+        (void)status;
+        (void)buffer2;
+        (void)buffer3;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing concurrent contexts ... ";
+    {
+        // a context with a different game master must not affect the others
+        auto other_gm_j = gm_j;
+        auto pos = other_gm_j.find("\"fastAttackBonusMultiplier\"");
+        assert(pos != std::string::npos);
+        other_gm_j.insert(other_gm_j.find(':', pos) + 1, " 2.5, \"unused\":");
+
+        const unsigned num_threads = 4;
+        std::vector<std::string> outputs(num_threads);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < num_threads; ++i)
+        {
+            threads.emplace_back([&, i]() {
+                auto ctx = GBS_create_context();
+                if (i == 0)
+                {
+                    auto config = GBS_config_ctx(ctx, other_gm_j.c_str());
+                    assert(config != nullptr);
+                    (void)config;
+                }
+                for (int k = 0; k < 20; ++k)
+                {
+                    int status = GBS_prepare_ctx(ctx, input_j.c_str());
+                    assert(status == 0);
+                    status = GBS_run_ctx(ctx);
+                    assert(status == 0);
+                    outputs[i] = GBS_collect_ctx(ctx);
+                    (void)status;
+                }
+                GBS_destroy_context(ctx);
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        assert(outputs[0] != expected);
+        for (unsigned i = 1; i < num_threads; ++i)
+        {
+            assert(outputs[i] == expected);
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing game master pinned at prepare ... ";
+    {
+        auto other_gm_j = gm_j;
+        auto pos = other_gm_j.find("\"fastAttackBonusMultiplier\"");
+        other_gm_j.insert(other_gm_j.find(':', pos) + 1, " 2.5, \"unused\":");
+
+        // a prepared simulation keeps its game master across GBS_config_ctx()
+        auto ctx = GBS_create_context();
+        int status = GBS_prepare_ctx(ctx, input_j.c_str());
+        assert(status == 0);
+        auto config = GBS_config_ctx(ctx, other_gm_j.c_str());
+        assert(config != nullptr);
+        status = GBS_run_ctx(ctx);
+        assert(status == 0);
+        std::string output = GBS_collect_ctx(ctx);
+        assert(output == expected);
+        status = GBS_prepare_ctx(ctx, input_j.c_str());
+        assert(status == 0);
+        status = GBS_run_ctx(ctx);
+        assert(status == 0);
+        std::string other_expected = GBS_collect_ctx(ctx);
+        assert(other_expected != expected);
+        GBS_destroy_context(ctx);
+
+        // and across GBS_config()
+        GBS_prepare(input_j.c_str());
+        GBS_config(other_gm_j.c_str());
+        GBS_run();
+        output = GBS_collect();
+        assert(output == expected);
+
+        // switching the global game master back and forth while contexts are created and run
+        std::thread switcher([&]() {
+            for (int k = 0; k < 20; ++k)
+            {
+                GBS_config((k % 2 ? other_gm_j : gm_j).c_str());
+            }
+        });
+        for (int k = 0; k < 20; ++k)
+        {
+            auto ctx = GBS_create_context();
+            status = GBS_prepare_ctx(ctx, input_j.c_str());
+            assert(status == 0);
+            status = GBS_run_ctx(ctx);
+            assert(status == 0);
+            output = GBS_collect_ctx(ctx);
+            assert(output == expected || output == other_expected);
+            GBS_destroy_context(ctx);
+        }
+        switcher.join();
+        GBS_config(gm_j.c_str());
+        (void)status;
+        (void)config;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing moves of inputs are not kept ... ";
+    {
+        auto ctx = GBS_create_context();
+        auto input = nlohmann::json::parse(input_j);
+        auto num_moves = GoBattleSim::MovePool::get().size();
+        for (int k = 0; k < 100; ++k)
+        {
+            input["pokemon"][0]["fmove"]["power"] = 5 + k;
+            int status = GBS_prepare_ctx(ctx, input.dump().c_str());
+            assert(status == 0);
+            status = GBS_run_ctx(ctx);
+            assert(status == 0);
+            (void)status;
+        }
+        assert(GoBattleSim::MovePool::get().size() == num_moves);
+
+        // the app is not run with the Pokemon of a failed prepare
+        input["pokemon"][0]["fmove"]["power"] = "strong";
+        int status = GBS_prepare_ctx(ctx, input.dump().c_str());
+        assert(status != 0);
+        status = GBS_run_ctx(ctx);
+        assert(status != 0);
+        assert(std::string(GBS_error_ctx(ctx)) == "no input prepared");
+        GBS_destroy_context(ctx);
+        (void)num_moves;
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing batch ... ";
+    {
+        auto expected_j = nlohmann::json::parse(expected);
+        auto input = nlohmann::json::parse(input_j);
+        std::vector<nlohmann::json> inputs(10, input);
+        inputs[4] = {{"battleMode", "nonsense"}};
+
+        auto outputs = nlohmann::json::parse(GBS_batch(nlohmann::json(inputs).dump().c_str()));
+        assert(outputs.size() == inputs.size());
+        for (unsigned i = 0; i < inputs.size(); ++i)
+        {
+            assert(i == 4 ? outputs[i].count("error") == 1 : outputs[i] == expected_j);
+        }
+
+        std::string lines = input.dump() + "\n\n" + input.dump() + "\n";
+        auto ctx = GBS_create_context();
+        std::istringstream iss(GBS_batch_ctx(ctx, lines.c_str()));
+        std::string line;
+        unsigned num_lines = 0;
+        while (std::getline(iss, line))
+        {
+            assert(nlohmann::json::parse(line) == expected_j);
+            ++num_lines;
+        }
+        assert(num_lines == 2);
+        GBS_destroy_context(ctx);
+    }
+    std::cout << "success" << std::endl;
+
+    return 0;
+}
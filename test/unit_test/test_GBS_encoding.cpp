@@ -0,0 +1,81 @@
+
+#include "GoBattleSim_extern.h"
+#include "json.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    GBS_config(read_file(root + "/setting/GBS.json").c_str());
+    auto input_j = read_file(root + "/examples/simple_pvp.json");
+
+    GBS_prepare(input_j.c_str());
+    GBS_run();
+    std::string expected = GBS_collect();
+    auto expected_j = nlohmann::json::parse(expected);
+    auto input = nlohmann::json::parse(input_j);
+
+    std::cout << "testing text encodings ... ";
+    {
+        size_t size = 0;
+        auto output = static_cast<const char *>(GBS_collect_encoded(GBS_ENCODING_JSON, &size));
+        assert(std::string(output, size) == expected);
+
+        output = static_cast<const char *>(GBS_collect_encoded(GBS_ENCODING_JSON_COMPACT, &size));
+        assert(std::string(output, size) == expected_j.dump());
+        (void)output;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing CBOR ... ";
+    {
+        auto cbor = nlohmann::json::to_cbor(input);
+        GBS_prepare_encoded(cbor.data(), cbor.size(), GBS_ENCODING_CBOR);
+        GBS_run();
+        size_t size = 0;
+        auto output = static_cast<const uint8_t *>(GBS_collect_encoded(GBS_ENCODING_CBOR, &size));
+        assert(nlohmann::json::from_cbor(output, output + size) == expected_j);
+        (void)output;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing MessagePack with context ... ";
+    {
+        auto msgpack = nlohmann::json::to_msgpack(input);
+        auto ctx = GBS_create_context();
+        int status = GBS_prepare_encoded_ctx(ctx, msgpack.data(), msgpack.size(), GBS_ENCODING_MSGPACK);
+        assert(status == 0);
+        status = GBS_run_ctx(ctx);
+        assert(status == 0);
+        size_t size = 0;
+        auto output = static_cast<const uint8_t *>(GBS_collect_encoded_ctx(ctx, GBS_ENCODING_MSGPACK, &size));
+        assert(nlohmann::json::from_msgpack(output, output + size) == expected_j);
+
+        // input that is not MessagePack
+        status = GBS_prepare_encoded_ctx(ctx, input_j.data(), input_j.size(), GBS_ENCODING_MSGPACK);
+        assert(status != 0);
+        auto unknown = GBS_collect_encoded_ctx(ctx, 42, &size);
+        assert(unknown == nullptr && size == 0);
+        GBS_destroy_context(ctx);
+        (void)status;
+        (void)output;
+        (void)unknown;
+    }
+    std::cout << "success" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "GoBattleSim_extern.h"
+#include "json.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+nlohmann::json simulate(const nlohmann::json &input)
+{
+    GBS_prepare(input.dump().c_str());
+    GBS_run();
+    return nlohmann::json::parse(GBS_collect());
+}
+
+void check_phases(const nlohmann::json &perf)
+{
+    assert(perf["prepareMs"].get<double>() >= 0);
+    assert(perf["runMs"].get<double>() >= 0);
+    assert(perf["buildOutputMs"].get<double>() >= 0);
+    assert(perf["encodeMs"].get<double>() >= 0);
+}
+
+nlohmann::json decode(const std::string &output, int encoding)
+{
+    switch (encoding)
+    {
+    case GBS_ENCODING_CBOR:
+        return nlohmann::json::from_cbor(output);
+    case GBS_ENCODING_MSGPACK:
+        return nlohmann::json::from_msgpack(output);
+    default:
+        return nlohmann::json::parse(output);
+    }
+}
+
+std::string encode(const nlohmann::json &j, int encoding)
+{
+    std::string out;
+    switch (encoding)
+    {
+    case GBS_ENCODING_JSON:
+        return j.dump(4);
+    case GBS_ENCODING_JSON_COMPACT:
+        return j.dump();
+    case GBS_ENCODING_CBOR:
+        nlohmann::json::to_cbor(j, out);
+        return out;
+    default:
+        nlohmann::json::to_msgpack(j, out);
+        return out;
+    }
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    GBS_config(read_file(root + "/setting/GBS.json").c_str());
+
+    auto raid = nlohmann::json::parse(read_file(root + "/examples/raid_solo.json"));
+    raid["numSims"] = 10;
+    raid["seed"] = 5;
+    auto pvp = nlohmann::json::parse(read_file(root + "/examples/simple_pvp.json"));
+    pvp["seed"] = 5;
+    auto matrix = nlohmann::json::parse(read_file(root + "/examples/battle_matrix_kanto_starters.json"));
+
+    std::cout << "testing perf of PvE ... ";
+    {
+        auto expected = simulate(raid);
+        raid["perf"] = true;
+        auto output = simulate(raid);
+        assert(output["output"] == expected);
+        const auto &perf = output["perf"];
+        check_phases(perf);
+        assert(perf["cached"] == false);
+#ifdef GBS_PERF_COUNTERS
+        assert(perf["events"]["Free"].get<int>() > 0);
+        assert(perf["events"]["Enter"].get<int>() >= 20);
+        assert(perf["heapPushes"].get<int>() >= perf["heapPops"].get<int>());
+        assert(perf["heapPops"].get<int>() > 0);
+        assert(perf["peakQueueDepth"].get<int>() > 0);
+        assert(perf["strategyCalls"]["onFree"].get<int>() > 0);
+#else
+        assert(!perf.contains("events"));
+#endif
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing perf of PvP ... ";
+    {
+        auto expected = simulate(pvp);
+        pvp["perf"] = true;
+        auto output = simulate(pvp);
+        assert(output["output"] == expected);
+        check_phases(output["perf"]);
+#ifdef GBS_PERF_COUNTERS
+        assert(output["perf"]["events"]["Fast"].get<int>() > 0);
+        assert(output["perf"]["heapPushes"] == 0);
+#endif
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing perf of battle matrix ... ";
+    {
+        matrix["perf"] = true;
+        auto output = simulate(matrix);
+        assert(output["output"].is_array());
+        check_phases(output["perf"]);
+#ifdef GBS_PERF_COUNTERS
+        // summed over the worker threads
+        assert(output["perf"]["events"]["Fast"].get<int>() > 0);
+        assert(output["perf"]["strategyCalls"]["onFree"].get<int>() > 0);
+#endif
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing perf of encoded output ... ";
+    {
+        auto pvp_no_perf = pvp;
+        pvp_no_perf.erase("perf");
+        auto expected = simulate(pvp_no_perf);
+        for (int encoding : {GBS_ENCODING_JSON, GBS_ENCODING_JSON_COMPACT, GBS_ENCODING_CBOR, GBS_ENCODING_MSGPACK})
+        {
+            GBS_prepare(pvp.dump().c_str());
+            GBS_run();
+            size_t size = 0;
+            auto data = static_cast<const char *>(GBS_collect_encoded(encoding, &size));
+            std::string output(data, size);
+            auto output_j = decode(output, encoding);
+            assert(output_j["output"] == expected);
+            check_phases(output_j["perf"]);
+            // the output is encoded before "perf" is added, and wrapped as if encoded as a whole
+            assert(encode(output_j, encoding) == output);
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing perf in a batch ... ";
+    {
+        auto raid_no_perf = raid;
+        raid_no_perf.erase("perf");
+        auto output = nlohmann::json::parse(GBS_batch(nlohmann::json::array({raid_no_perf, raid}).dump().c_str()));
+        assert(output[1]["output"] == output[0]);
+        check_phases(output[1]["perf"]);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing perf of cached output ... ";
+    {
+        GBS_cache_config(4, NULL);
+        simulate(raid);
+        auto output = simulate(raid);
+        assert(output["perf"]["cached"] == true);
+        assert(!output["perf"].contains("events"));
+        GBS_cache_config(0, NULL);
+    }
+    std::cout << "success" << std::endl;
+
+    return 0;
+}
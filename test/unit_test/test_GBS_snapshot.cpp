@@ -0,0 +1,132 @@
+#include "GoBattleSim_extern.h"
+#include "json.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+std::string simulate(const std::string &input_j)
+{
+    GBS_prepare(input_j.c_str());
+    GBS_run();
+    return GBS_collect();
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    auto gm_j = read_file(root + "/setting/GBS.json");
+    auto input = nlohmann::json::parse(read_file(root + "/examples/simple_pvp.json"));
+    input["seed"] = 1;
+    auto other_gm = nlohmann::json::parse(gm_j);
+    other_gm["PvPBattleSettings"]["sameTypeAttackBonusMultiplier"] = 2;
+
+    GBS_config(gm_j.c_str());
+    std::string expected_gm = GBS_config(NULL);
+    auto expected = simulate(input.dump());
+
+    char path_template[] = "/tmp/gbs_snapshot_XXXXXX";
+    int fd = mkstemp(path_template);
+    assert(fd >= 0);
+    close(fd);
+    std::string path = path_template;
+
+    std::cout << "testing compile and load ... ";
+    {
+        // compiling does not touch the game master in use
+        GBS_config(other_gm.dump().c_str());
+        GBS_compile_snapshot(gm_j.c_str(), path.c_str());
+        assert(std::string(GBS_config(NULL)) != expected_gm);
+
+        GBS_load_snapshot(path.c_str());
+        std::string loaded_gm = GBS_config(NULL);
+        assert(loaded_gm == expected_gm);
+        auto output = simulate(input.dump());
+        assert(output == expected);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing load with context ... ";
+    {
+        GBS_config(other_gm.dump().c_str());
+        auto ctx = GBS_create_context();
+        int status = GBS_load_snapshot_ctx(ctx, path.c_str());
+        assert(status == 0);
+        std::string loaded_gm = GBS_config_ctx(ctx, NULL);
+        assert(loaded_gm == expected_gm);
+        status = GBS_prepare_ctx(ctx, input.dump().c_str());
+        assert(status == 0);
+        status = GBS_run_ctx(ctx);
+        assert(status == 0);
+        std::string output = GBS_collect_ctx(ctx);
+        assert(output == expected);
+
+        // a truncated snapshot is rejected and leaves the game master as it was
+        auto snapshot = read_file(path);
+        std::ofstream(path, std::ios::binary) << snapshot.substr(0, snapshot.size() - 1);
+        status = GBS_load_snapshot_ctx(ctx, path.c_str());
+        assert(status != 0);
+        assert(std::string(GBS_error_ctx(ctx)).find("truncated") != std::string::npos);
+        loaded_gm = GBS_config_ctx(ctx, NULL);
+        assert(loaded_gm == expected_gm);
+        status = GBS_load_snapshot_ctx(ctx, (root + "/setting/GBS.json").c_str());
+        assert(status != 0);
+
+        // so is a snapshot compiled by another build
+        auto build = snapshot.find(GBS_version());
+        assert(build != std::string::npos);
+        snapshot[build] ^= 1;
+        std::ofstream(path, std::ios::binary) << snapshot;
+        status = GBS_load_snapshot_ctx(ctx, path.c_str());
+        assert(status != 0);
+        assert(std::string(GBS_error_ctx(ctx)).find("another version or build") != std::string::npos);
+        snapshot[build] ^= 1;
+
+        // or with another size of Move or SpeciesEntry, the header fields after the magic, version and GameMaster size
+        for (size_t offset : {12, 16})
+        {
+            snapshot[offset] ^= 1;
+            std::ofstream(path, std::ios::binary) << snapshot;
+            status = GBS_load_snapshot_ctx(ctx, path.c_str());
+            assert(status != 0);
+            assert(std::string(GBS_error_ctx(ctx)).find("another version or build") != std::string::npos);
+            snapshot[offset] ^= 1;
+        }
+        GBS_destroy_context(ctx);
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing cache across JSON and snapshot ... ";
+    {
+        GBS_compile_snapshot(gm_j.c_str(), path.c_str());
+        GBS_cache_config(4, NULL);
+        GBS_config(gm_j.c_str());
+        auto output = simulate(input.dump());
+        assert(output == expected);
+        GBS_load_snapshot(path.c_str());
+        output = simulate(input.dump());
+        assert(output == expected);
+        unsigned long long num_hits = 0, num_misses = 0;
+        GBS_cache_stats(&num_hits, &num_misses);
+        assert(num_hits == 1 && num_misses == 1);
+        GBS_cache_config(0, NULL);
+    }
+    std::cout << "success" << std::endl;
+
+    remove(path.c_str());
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "GoBattleSim_extern.h"
+#include "json.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdio.h>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+nlohmann::json simulate(const nlohmann::json &input)
+{
+    GBS_prepare(input.dump().c_str());
+    GBS_run();
+    return nlohmann::json::parse(GBS_collect());
+}
+
+/**
+ * The events of process @param pid with phase @param ph and name @param name (any name if empty).
+ */
+std::vector<nlohmann::json> find_events(const nlohmann::json &trace, unsigned pid, const std::string &ph,
+                                        const std::string &name = "")
+{
+    std::vector<nlohmann::json> events;
+    for (const auto &event : trace["traceEvents"])
+    {
+        if (event["pid"] == pid && event["ph"] == ph && (name.empty() || event["name"] == name))
+        {
+            events.push_back(event);
+        }
+    }
+    return events;
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    GBS_config(read_file(root + "/setting/GBS.json").c_str());
+    std::string path = "/tmp/gbs_trace_" + std::to_string(getpid()) + ".json";
+
+    std::cout << "testing PvE trace ... ";
+    {
+        auto raid = nlohmann::json::parse(read_file(root + "/examples/raid_solo.json"));
+        raid["numSims"] = 3;
+        raid["seed"] = 2;
+        auto expected = simulate(raid);
+        raid["traceFile"] = path;
+        auto output = simulate(raid);
+        assert(output == expected);
+
+        auto trace = nlohmann::json::parse(read_file(path));
+        assert(find_events(trace, 0, "X", "GBS_prepare").size() == 1);
+        assert(find_events(trace, 0, "X", "sim").size() == 3);
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            // one track per player, a span per move used
+            std::set<unsigned> tracks;
+            for (const auto &event : find_events(trace, i + 1, "X"))
+            {
+                tracks.insert(event["tid"].get<unsigned>());
+                assert(event["dur"].get<double>() > 0);
+            }
+            assert(tracks.size() == 2);
+            auto fast = find_events(trace, i + 1, "X", "Fast");
+            assert(!fast.empty());
+            // Confusion, 1600 ms long and hitting 600 ms in
+            assert(fast[0]["dur"] == 1600000.0);
+            size_t num_fmoves = 0;
+            for (const auto &event : expected[i]["battleLog"])
+            {
+                num_fmoves += event["type"] == "Fast" ? 1 : 0;
+            }
+            assert(fast.size() == num_fmoves);
+            assert(find_events(trace, i + 1, "i", "Damage").size() > 0);
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing PvP trace ... ";
+    {
+        auto pvp = nlohmann::json::parse(read_file(root + "/examples/simple_pvp.json"));
+        pvp["traceFile"] = path;
+        simulate(pvp);
+        auto trace = nlohmann::json::parse(read_file(path));
+        assert(find_events(trace, 1, "X", "Fast").size() > 0);
+        assert(find_events(trace, 1, "X", "Enter").size() == 2);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing battle matrix trace ... ";
+    {
+        auto matrix = nlohmann::json::parse(read_file(root + "/examples/battle_matrix_kanto_starters.json"));
+        matrix["traceFile"] = path;
+        auto output = simulate(matrix);
+        auto trace = nlohmann::json::parse(read_file(path));
+        // every unique row or column range is a span of a worker thread
+        auto rows = find_events(trace, 0, "X", "matrix row");
+        auto cols = find_events(trace, 0, "X", "matrix columns");
+        assert(rows.size() + cols.size() > 0);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing bad trace file ... ";
+    {
+        auto pvp = nlohmann::json::parse(read_file(root + "/examples/simple_pvp.json"));
+        pvp["traceFile"] = "/nonexistent/dir/trace.json";
+        auto ctx = GBS_create_context();
+        int status = GBS_prepare_ctx(ctx, pvp.dump().c_str());
+        assert(status == 0);
+        status = GBS_run_ctx(ctx);
+        assert(status != 0);
+        assert(std::string(GBS_error_ctx(ctx)).find("cannot open") != std::string::npos);
+        GBS_destroy_context(ctx);
+        (void)status;
+    }
+    std::cout << "success" << std::endl;
+
+    remove(path.c_str());
+
+    return 0;
+}
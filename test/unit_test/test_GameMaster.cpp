@@ -4,6 +4,9 @@
 
 #include "GameMaster.h"
 #include "Pokemon.h"
+#include "PvPPokemon.h"
+
+#include <stdexcept>
 
 using namespace GoBattleSim;
 
@@ -34,6 +37,7 @@ int main()
     std::cout << "testing calc_damage ... ";
 
     Pokemon attacker, defender;
+    Move fmove;
     attacker.poketype1 = 0;
     attacker.poketype2 = -1;
     attacker.attack = 200;
@@ -42,38 +46,94 @@ int main()
     defender.poketype2 = 2;
     defender.defense = 100;
 
-    attacker.fmove.poketype = 2;
-    attacker.fmove.power = 24;
+    fmove.poketype = 2;
+    fmove.power = 24;
 
-    int dmg1 = calc_damage(&attacker, &attacker.fmove, &defender, 0);
+    int dmg1 = calc_damage(&attacker, &fmove, &defender, 0);
 
     // assert(dmg1 == 24); // not sure if it's (floor(x) + 1) or ceil(x). to be researched
 
     std::cout << "success" << std::endl;
 
     std::cout << "testing STAB ... ";
-    attacker.fmove.poketype = attacker.poketype1;
-    int dmg2 = calc_damage(&attacker, &attacker.fmove, &defender, 1.0);
+    fmove.poketype = attacker.poketype1;
+    int dmg2 = calc_damage(&attacker, &fmove, &defender, 1.0);
     assert(dmg2 > dmg1);
     std::cout << "success" << std::endl;
 
     std::cout << "testing 1x super effectiveness ... ";
-    gm.effectiveness(attacker.fmove.poketype, defender.poketype1, 1.6);
-    int dmg3 = calc_damage(&attacker, &attacker.fmove, &defender, 1.0);
+    gm.effectiveness(fmove.poketype, defender.poketype1, 1.6);
+    int dmg3 = calc_damage(&attacker, &fmove, &defender, 1.0);
     assert(dmg3 > dmg2);
     std::cout << "success" << std::endl;
 
     std::cout << "testing 2x super effectiveness ... ";
-    gm.effectiveness(attacker.fmove.poketype, defender.poketype2, 1.6);
-    int dmg4 = calc_damage(&attacker, &attacker.fmove, &defender, 1.0);
+    gm.effectiveness(fmove.poketype, defender.poketype2, 1.6);
+    int dmg4 = calc_damage(&attacker, &fmove, &defender, 1.0);
     assert(dmg4 > dmg3);
     std::cout << "success" << std::endl;
 
     std::cout << "testing multiplier ... ";
-    gm.boosted_weather(attacker.fmove.poketype, 7);
-    int dmg5 = calc_damage(&attacker, &attacker.fmove, &defender, 1.3);
+    gm.boosted_weather(fmove.poketype, 7);
+    int dmg5 = calc_damage(&attacker, &fmove, &defender, 1.3);
     assert(dmg5 > dmg4);
     std::cout << "success" << std::endl;
 
+    std::cout << "testing dual type effectiveness ... ";
+    gm.effectiveness(3, 4, 0.625);
+    for (int i = -1; i < static_cast<int>(num_types); ++i)
+    {
+        for (int j = -1; j < static_cast<int>(num_types); ++j)
+        {
+            for (int k = -1; k < static_cast<int>(num_types); ++k)
+            {
+                assert(gm.dual_effectiveness(i, GameMaster::type_pair(j, k)) == gm.effectiveness(i, j) * gm.effectiveness(i, k));
+            }
+        }
+    }
+    assert(gm.dual_effectiveness(3, GameMaster::type_pair(4, 4)) == 0.625 * 0.625);
+    // types out of range are neutral, like in effectiveness()
+    assert(gm.dual_effectiveness(-2, GameMaster::type_pair(4, 4)) == 1);
+    assert(gm.dual_effectiveness(MAX_NUM_TYPES, GameMaster::type_pair(4, 4)) == 1);
+    assert(gm.dual_effectiveness(3, GameMaster::type_pair(-7, 4)) == gm.effectiveness(3, 4));
+    assert(gm.dual_effectiveness(3, GameMaster::type_pair(4, 1000)) == gm.effectiveness(3, 4));
+    assert(calc_damage(&attacker, &fmove, &defender, GameMaster::type_pair(defender.poketype1, defender.poketype2), 1.3, gm) == dmg5);
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing stage multipliers ... ";
+    gm.set_stage_bounds(-2, 3);
+    for (int i = -2; i <= 3; ++i)
+    {
+        gm.atk_stage_multiplier(i, 1 + i * 0.25);
+        gm.def_stage_multiplier(i, 1 - i * 0.125);
+    }
+    {
+        PvPPokemon pkm(0, -1, 200, 100, 150, 0);
+        pkm.init();
+        pkm.buff(2, -1);
+        assert(pkm.attack == 200 * 1.5 && pkm.defense == 100 * 1.125);
+        // clamped to the stage bounds
+        pkm.buff(5, -5);
+        assert(pkm.attack_stage == 3 && pkm.defense_stage == -2);
+        assert(pkm.attack == 200 * 1.75 && pkm.defense == 100 * 1.25);
+        pkm.init();
+        assert(pkm.attack == 200 && pkm.defense == 100 && pkm.attack_stage == 0);
+    }
+    gm.check_stage_bounds();
+    gm.max_stage = gm.min_stage + MAX_NUM_STAGES;
+    bool thrown = false;
+    try
+    {
+        gm.check_stage_bounds();
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    (void)thrown;
+    gm.set_stage_bounds(-2, 3);
+    std::cout << "success" << std::endl;
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,225 @@
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <assert.h>
+#include <math.h>
+
+#include "GameMaster.h"
+#include "BattleMatrix.h"
+#include "MatrixWriter.h"
+
+using namespace GoBattleSim;
+
+Matrix_t read_binary_matrix(const char *path, MatrixFileHeader &header)
+{
+    FILE *file = fopen(path, "rb");
+    assert(file != nullptr);
+    assert(read_matrix_file_header(file, header));
+    Matrix_t matrix(header.num_rows, std::vector<double>(header.num_cols));
+    for (unsigned i = 0; i < header.num_rows; ++i)
+    {
+        for (unsigned j = 0; j < header.num_cols; ++j)
+        {
+            // the test machine is assumed to be little-endian
+            if (header.element_size == 8)
+            {
+                fread(&matrix[i][j], 8, 1, file);
+            }
+            else
+            {
+                float value;
+                fread(&value, 4, 1, file);
+                matrix[i][j] = value;
+            }
+        }
+    }
+    fclose(file);
+    return matrix;
+}
+
+int main()
+{
+    std::cout << "setting gamemaster ... ";
+    GameMaster::get().num_types(3);
+    GameMaster::get().effectiveness(0, 1, 1.6);
+    GameMaster::get().effectiveness(1, 2, 1.6);
+    GameMaster::get().effectiveness(2, 0, 1.6);
+    std::cout << "done" << std::endl;
+
+    std::cout << "defining pokemon ... ";
+    Move fmoves[3] = {{0, 6, 8, 2}, {1, 3, 9, 2}, {2, 8, 7, 2}};
+    Move cmoves[3] = {{0, 100, -55}, {1, 70, -45}, {2, 120, -65}};
+    // row and column attacks never tie, so that no battle involves randomness
+    std::vector<PvPPokemon> pkm_list, col_pkm_list;
+    for (int i = 0; i < 9; ++i)
+    {
+        PvPPokemon pkm(i % 3, -1, 120 + 7 * i, 110 + 3 * i, 130 + 5 * i, 0);
+        pkm.add_fmove(&fmoves[i % 3]);
+        pkm.add_cmove(&cmoves[(i / 3) % 3]);
+        pkm_list.push_back(pkm);
+
+        PvPPokemon col_pkm(i % 3, -1, 123.5 + 7 * i, 110 + 3 * i, 130 + 5 * i, 0);
+        col_pkm.add_fmove(&fmoves[(i + 1) % 3]);
+        col_pkm.add_cmove(&cmoves[i % 3]);
+        col_pkm_list.push_back(col_pkm);
+    }
+    std::cout << "done" << std::endl;
+
+    BattleMatrix bm;
+    bm.set(pkm_list, col_pkm_list, false);
+    bm.run();
+    Matrix_t expected = bm.get();
+
+    std::cout << "testing out-of-order rows ... ";
+    {
+        MatrixWriter writer("test_MatrixWriter_order.csv", MatrixFileFormat::CSV);
+        MatrixFileHeader header;
+        header.num_rows = 3;
+        header.num_cols = 1;
+        writer.open(header);
+        double values[3] = {0.0, 1.0, 2.0};
+        writer.write_row(2, values + 2);
+        writer.write_row(0, values + 0);
+        writer.write_row(1, values + 1);
+        writer.close();
+        std::ifstream ifs("test_MatrixWriter_order.csv");
+        double v0, v1, v2;
+        ifs >> v0 >> v1 >> v2;
+        assert(v0 == 0.0 && v1 == 1.0 && v2 == 2.0);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing float64 streaming ... ";
+    {
+        MatrixWriter writer("test_MatrixWriter.f64", MatrixFileFormat::Float64);
+        bm.set(pkm_list, col_pkm_list, false);
+        bm.set_writer(&writer);
+        bm.run();
+        assert(bm.get().empty());
+
+        MatrixFileHeader header;
+        auto matrix = read_binary_matrix("test_MatrixWriter.f64", header);
+        assert(header.num_rows == pkm_list.size() && header.total_cols == col_pkm_list.size());
+        assert(matrix == expected);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing float32 streaming ... ";
+    {
+        MatrixWriter writer("test_MatrixWriter.f32", MatrixFileFormat::Float32);
+        bm.set_writer(&writer);
+        bm.run();
+
+        MatrixFileHeader header;
+        auto matrix = read_binary_matrix("test_MatrixWriter.f32", header);
+        for (unsigned i = 0; i < expected.size(); ++i)
+        {
+            for (unsigned j = 0; j < expected[i].size(); ++j)
+            {
+                assert(fabs(matrix[i][j] - expected[i][j]) < 1e-6);
+            }
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing CSV streaming ... ";
+    {
+        MatrixWriter writer("test_MatrixWriter.csv", MatrixFileFormat::CSV);
+        bm.set_writer(&writer);
+        bm.run();
+
+        std::ifstream ifs("test_MatrixWriter.csv");
+        for (unsigned i = 0; i < expected.size(); ++i)
+        {
+            for (unsigned j = 0; j < expected[i].size(); ++j)
+            {
+                double value;
+                char sep;
+                ifs >> value;
+                if (j + 1 < expected[i].size())
+                {
+                    ifs >> sep;
+                }
+                assert(value == expected[i][j]);
+            }
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing tile merging ... ";
+    {
+        // four tiles of uneven size, written in any order
+        unsigned row_split = 4, col_split = 5;
+        unsigned row_ranges[2][2] = {{0, row_split}, {row_split, 9}};
+        unsigned col_ranges[2][2] = {{0, col_split}, {col_split, 9}};
+        std::vector<std::string> paths;
+        for (unsigned r = 0; r < 2; ++r)
+        {
+            for (unsigned c = 0; c < 2; ++c)
+            {
+                std::vector<PvPPokemon> row_tile(pkm_list.begin() + row_ranges[r][0], pkm_list.begin() + row_ranges[r][1]);
+                std::vector<PvPPokemon> col_tile(col_pkm_list.begin() + col_ranges[c][0], col_pkm_list.begin() + col_ranges[c][1]);
+                paths.push_back("test_MatrixWriter_tile_" + std::to_string(r) + std::to_string(c) + ".f64");
+                MatrixWriter writer(paths.back(), MatrixFileFormat::Float64);
+                bm.set(row_tile, col_tile, false);
+                bm.set_tile(row_ranges[r][0], col_ranges[c][0], 9, 9);
+                bm.set_writer(&writer);
+                bm.run();
+            }
+        }
+        std::reverse(paths.begin(), paths.end());
+
+        Matrix_t matrix;
+        merge_matrix_tiles(paths, matrix);
+        assert(matrix == expected);
+
+        // row bands can be merged into another file
+        std::vector<std::string> band_paths;
+        for (unsigned r = 0; r < 2; ++r)
+        {
+            std::vector<PvPPokemon> row_tile(pkm_list.begin() + row_ranges[r][0], pkm_list.begin() + row_ranges[r][1]);
+            band_paths.push_back("test_MatrixWriter_band_" + std::to_string(r) + ".f64");
+            MatrixWriter writer(band_paths.back(), MatrixFileFormat::Float64);
+            bm.set(row_tile, col_pkm_list, false);
+            bm.set_tile(row_ranges[r][0], 0, 9, 9);
+            bm.set_writer(&writer);
+            bm.run();
+        }
+        MatrixWriter merged("test_MatrixWriter_merged.f64", MatrixFileFormat::Float64);
+        merge_matrix_tiles(band_paths, merged);
+        MatrixFileHeader header;
+        assert(read_binary_matrix("test_MatrixWriter_merged.f64", header) == expected);
+        assert(header.row_offset == 0 && header.total_rows == 9);
+    }
+    std::cout << "success" << std::endl;
+
+#ifdef __linux__
+    std::cout << "testing write errors ... ";
+    {
+        // every write to /dev/full fails with no space left, at the latest when the file is closed
+        for (auto format : {MatrixFileFormat::CSV, MatrixFileFormat::Float64, MatrixFileFormat::Float32})
+        {
+            MatrixWriter writer("/dev/full", format);
+            bm.set(pkm_list, col_pkm_list, false);
+            bm.set_tile(0, 0, 9, 9);
+            bm.set_writer(&writer);
+            bool thrown = false;
+            try
+            {
+                bm.run();
+            }
+            catch (const std::runtime_error &e)
+            {
+                thrown = std::string(e.what()).find("cannot write matrix file /dev/full") == 0;
+            }
+            assert(thrown);
+            (void)thrown;
+        }
+        bm.set_writer(nullptr);
+    }
+    std::cout << "success" << std::endl;
+#endif
+
+    return 0;
+}
@@ -62,25 +62,25 @@ int main()
 	std::cout << "defining pokemon ... ";
 
 	// (poketyp1, poketyp2, attack, defense, max_hp)
-	PvPPokemon pokemon_lucario(1, 2, 190.39096, 121.08865056, 142);
+	PvPPokemon pokemon_lucario(1, 2, 190.39096, 121.08865056, 142, 0);
 	pokemon_lucario.add_fmove(&move_counter);
 	pokemon_lucario.add_cmove(&move_power_up_punch);
 	//pokemon_lucario.add_cmove(&move_shadow_ball);
 
-	PvPPokemon pokemon_groudon(5, -1, 225.23550285000002, 192.04290243000003, 173);
+	PvPPokemon pokemon_groudon(5, -1, 225.23550285000002, 192.04290243000003, 173, 0);
 	pokemon_groudon.add_fmove(&move_mud_shot);
 	pokemon_groudon.add_cmove(&move_earthquake);
 
-	PvPPokemon pokemon_dialga(0, 2, 229.1870029, 178.60780226, 173);
+	PvPPokemon pokemon_dialga(0, 2, 229.1870029, 178.60780226, 173, 0);
 	pokemon_dialga.add_fmove(&move_dragon_breath);
 	pokemon_dialga.add_cmove(&move_iron_head);
 
-	PvPPokemon pokemon_giratina_altered(0, 3, 137.59531384, 162.11725095999998, 203);
+	PvPPokemon pokemon_giratina_altered(0, 3, 137.59531384, 162.11725095999998, 203, 0);
 	pokemon_giratina_altered.add_fmove(&move_shadow_claw);
 	pokemon_giratina_altered.add_cmove(&move_ancient_power);
 	//pokemon_giratina_altered.add_cmove(&move_dragon_claw);
 
-	PvPPokemon pokemon_poliwrath(1, 6, 119.149306358, 120.35894398600001, 131);
+	PvPPokemon pokemon_poliwrath(1, 6, 119.149306358, 120.35894398600001, 131, 0);
 	pokemon_poliwrath.add_fmove(&move_bubble);
 	pokemon_poliwrath.add_cmove(&move_power_up_punch);
 
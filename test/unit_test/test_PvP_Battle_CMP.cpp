@@ -30,11 +30,11 @@ int main()
 	std::cout << "defining pokemon ... ";
 
 	// (poketyp1, poketyp2, attack, defense, max_hp)
-	PvPPokemon pokemon_groudon(1, -1, 225.2355, 192.0429, 173);
+	PvPPokemon pokemon_groudon(1, -1, 225.2355, 192.0429, 173, 0);
 	pokemon_groudon.add_fmove(&move_mud_shot);
 	pokemon_groudon.add_cmove(&move_solar_beam);
 
-	PvPPokemon pokemon_groudon2(1, -1, 226.0, 192.0429, 173); // higher attack
+	PvPPokemon pokemon_groudon2(1, -1, 226.0, 192.0429, 173, 0); // higher attack
 	pokemon_groudon2.add_fmove(&move_mud_shot);
 	pokemon_groudon2.add_cmove(&move_solar_beam);
 
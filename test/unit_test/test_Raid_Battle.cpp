@@ -5,6 +5,7 @@
 
 #include "GameMaster.h"
 #include "Battle.h"
+#include "Random.h"
 
 using namespace GoBattleSim;
 
@@ -37,23 +38,23 @@ int main()
 
 	// Set up Pokemon
 	// (poketyp1, poketyp2, attack, defense, max_hp)
-	Pokemon pokemon_mewtwo = Pokemon(0, -1, 248.94450315, 155.68910197000002, 180);
+	Pokemon pokemon_mewtwo = Pokemon(0, -1, 248.94450315, 155.68910197000002, 180, 0);
 	pokemon_mewtwo.add_fmove(&move_confusion);
 	pokemon_mewtwo.add_cmove(&move_psychic);
 
-	Pokemon pokemon_latios = Pokemon(0, -1, 223.65490283000003, 179.39810227, 162);
+	Pokemon pokemon_latios = Pokemon(0, -1, 223.65490283000003, 179.39810227, 162, 0);
 	pokemon_latios.add_fmove(&move_zen_headbutt);
 	pokemon_latios.add_cmove(&move_psychic);
 
-	Pokemon pokemon_lugia = Pokemon(0, 3, 164.38240208000002, 256.84750325000005, 197);
+	Pokemon pokemon_lugia = Pokemon(0, 3, 164.38240208000002, 256.84750325000005, 197, 0);
 	pokemon_lugia.add_fmove(&move_extrasensory);
 	pokemon_lugia.add_cmove(&move_sky_attack);
 
-	Pokemon pokemon_machamp = Pokemon(1, -1, 181.7700047492981, 127.02000331878662, 3600);
+	Pokemon pokemon_machamp = Pokemon(1, -1, 181.7700047492981, 127.02000331878662, 3600, 0);
 	pokemon_machamp.add_fmove(&move_counter);
 	pokemon_machamp.add_cmove(&move_dynamic_punch);
 
-	srand(1000);
+	seed_random(1000);
 
 	// 1 x Mewtwo VS T3 Machamp
 	// 1 x Mewtwo VS T3 Machamp with BackgroundDPS
@@ -0,0 +1,98 @@
+
+#include <iostream>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "TeamSearch.h"
+
+using namespace GoBattleSim;
+
+std::vector<TeamScore> search_teams_naive(const Matrix_t &matrix, double threshold)
+{
+    std::vector<TeamScore> teams;
+    unsigned n = matrix.size();
+    for (unsigned a = 0; a < n; ++a)
+    {
+        for (unsigned b = a + 1; b < n; ++b)
+        {
+            for (unsigned c = b + 1; c < n; ++c)
+            {
+                TeamScore team;
+                team.members[0] = a;
+                team.members[1] = b;
+                team.members[2] = c;
+                team.worst = 1e9;
+                for (unsigned j = 0; j < matrix[a].size(); ++j)
+                {
+                    double best = std::max(matrix[a][j], std::max(matrix[b][j], matrix[c][j]));
+                    team.average += best / matrix[a].size();
+                    team.worst = std::min(team.worst, best);
+                    team.coverage += best > threshold;
+                }
+                teams.push_back(team);
+            }
+        }
+    }
+    return teams;
+}
+
+int main()
+{
+    srand(7);
+    const unsigned num_rows = 40, num_cols = 150;
+    Matrix_t matrix(num_rows, std::vector<double>(num_cols));
+    for (auto &row : matrix)
+    {
+        for (auto &score : row)
+        {
+            score = (rand() % 2001 - 1000) / 1000.0;
+        }
+    }
+    auto naive = search_teams_naive(matrix, 0.0);
+
+    TeamSearchOptions options;
+    options.top_k = 5;
+
+    std::cout << "testing average objective ... ";
+    options.objective = TeamObjective::Average;
+    auto teams = search_teams(matrix, options);
+    assert(teams.size() == 5);
+    for (const auto &team : naive)
+    {
+        assert(team.average <= teams[0].average + 1e-6);
+        (void)team;
+    }
+    for (unsigned i = 1; i < teams.size(); ++i)
+    {
+        assert(teams[i].average <= teams[i - 1].average + 1e-6);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing worst objective ... ";
+    options.objective = TeamObjective::Worst;
+    teams = search_teams(matrix, options);
+    for (const auto &team : naive)
+    {
+        assert(team.worst <= teams[0].worst + 1e-6);
+        (void)team;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing coverage objective ... ";
+    options.objective = TeamObjective::Coverage;
+    teams = search_teams(matrix, options);
+    for (const auto &team : naive)
+    {
+        assert(team.coverage <= teams[0].coverage);
+        (void)team;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing too few rows ... ";
+    matrix.resize(2);
+    assert(search_teams(matrix, options).empty());
+    std::cout << "success" << std::endl;
+
+    return 0;
+}
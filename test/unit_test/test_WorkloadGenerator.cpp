@@ -0,0 +1,111 @@
+#include "GoBattleSim_extern.h"
+#include "WorkloadGenerator.h"
+#include "json.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+using namespace GoBattleSim;
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    assert(ifs.good());
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+int main()
+{
+    std::string root(__FILE__);
+    root = root.substr(0, root.rfind("/test/unit_test/"));
+    auto gm = read_file(root + "/GBS_GAME_MASTER.json");
+
+    std::cout << "testing workload weights ... ";
+    {
+        double weights[4];
+        parse_workload_weights("pvp:2,raid:0.5", {"raid", "gym", "pvp", "matrix"}, weights);
+        assert(weights[0] == 0.5 && weights[1] == 0 && weights[2] == 2 && weights[3] == 0);
+        bool thrown = false;
+        try
+        {
+            parse_workload_weights("dynamax:1", {"raid", "gym", "pvp", "matrix"}, weights);
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+        (void)thrown;
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing workload is reproducible ... ";
+    {
+        WorkloadOptions options;
+        options.num_inputs = 20;
+        options.seed = 7;
+        auto inputs = generate_workload(gm, options);
+        assert(inputs.size() == 20);
+        assert(generate_workload(gm, options) == inputs);
+        options.seed = 8;
+        assert(generate_workload(gm, options) != inputs);
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing workload mix and sizes ... ";
+    {
+        WorkloadOptions options;
+        options.num_inputs = 10;
+        parse_workload_weights("matrix", {"raid", "gym", "pvp", "matrix"}, options.mode_weights);
+        parse_workload_weights("large", {"small", "medium", "large"}, options.size_weights);
+        for (const auto &input_j : generate_workload(gm, options))
+        {
+            auto input = nlohmann::json::parse(input_j);
+            assert(input["battleMode"] == "battlematrix");
+            assert(input["rowPokemon"].size() > 40 && input["rowPokemon"].size() <= 100);
+        }
+
+        parse_workload_weights("raid", {"raid", "gym", "pvp", "matrix"}, options.mode_weights);
+        parse_workload_weights("small", {"small", "medium", "large"}, options.size_weights);
+        for (const auto &input_j : generate_workload(gm, options))
+        {
+            auto input = nlohmann::json::parse(input_j);
+            assert(input["battleMode"] == "raid");
+            // the boss and one attacker
+            assert(input["players"].size() == 2);
+            assert(input["players"][0]["team"] == 0);
+        }
+    }
+    std::cout << "success" << std::endl;
+
+    std::cout << "testing workload inputs run ... ";
+    {
+        WorkloadOptions options;
+        options.num_inputs = 40;
+        options.seed = 1;
+        parse_workload_weights("small:3,medium:1", {"small", "medium", "large"}, options.size_weights);
+        auto ctx = GBS_create_context();
+        auto config = GBS_config_ctx(ctx, gm.c_str());
+        assert(config != nullptr);
+        for (const auto &input : generate_workload(gm, options))
+        {
+            int status = GBS_prepare_ctx(ctx, input.c_str());
+            assert(status == 0);
+            status = GBS_run_ctx(ctx);
+            assert(status == 0);
+            auto output = GBS_collect_ctx(ctx);
+            assert(output != nullptr);
+            (void)status;
+            (void)output;
+        }
+        GBS_destroy_context(ctx);
+        (void)config;
+    }
+    std::cout << "success" << std::endl;
+
+    return 0;
+}